@@ -6,8 +6,8 @@
 // Sets default values
 ABlueprintFunctionality::ABlueprintFunctionality()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	//the UI is updated through the On... events rather than every frame, so this actor doesn't need to tick
+	PrimaryActorTick.bCanEverTick = false;
 
 }
 
@@ -19,10 +19,36 @@ void ABlueprintFunctionality::BeginPlay()
 	uiUpdated = false;
 }
 
-// Called every frame
-void ABlueprintFunctionality::Tick(float DeltaTime)
+void ABlueprintFunctionality::NextQueueChanged()
 {
-	Super::Tick(DeltaTime);
+	//set ui updated to false for blueprints still reading the flag, then tell any listeners
+	uiUpdated = false;
+	OnNextQueueChanged.Broadcast(nextTetrominoNumbers);
+}
+
+void ABlueprintFunctionality::ScoreChanged(int score)
+{
+	OnScoreChanged.Broadcast(score);
+}
+
+void ABlueprintFunctionality::LevelChanged(int level)
+{
+	OnLevelChanged.Broadcast(level);
+}
+
+void ABlueprintFunctionality::GameOver()
+{
+	//only end the game once
+	if (bGameOver) {
+		return;
+	}
 
+	bGameOver = true;
+	OnGameOver.Broadcast();
 }
 
+void ABlueprintFunctionality::LatencyChanged(const FString& text)
+{
+	latencyText = text;
+	OnLatencyChanged.Broadcast(latencyText);
+}
@@ -6,6 +6,21 @@
 #include "GameFramework/Actor.h"
 #include "BlueprintFunctionality.generated.h"
 
+//fired when the next tetromino queue changes, passing the indexes of the next 3 tetrominoes
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnNextQueueChanged, const TArray<int>&, NextTetrominoNumbers);
+
+//fired when the player's score changes, passing the new score
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnScoreChanged, int, Score);
+
+//fired when the player reaches a new level, passing the new level
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnLevelChanged, int, Level);
+
+//fired once when the game ends
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnGameOver);
+
+//fired when the input latency percentiles are updated, passing them as text for the HUD
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnLatencyChanged, const FString&, LatencyText);
+
 //controls c++ functionality of blueprints used for UI
 UCLASS()
 class ASSIGNMENT2PROJECT_API ABlueprintFunctionality : public AActor
@@ -21,8 +36,20 @@ protected:
 	virtual void BeginPlay() override;
 
 public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	//updates the next tetromino flag and tells the UI the queue has changed
+	void NextQueueChanged();
+
+	//tells the UI the score has changed
+	void ScoreChanged(int score);
+
+	//tells the UI the level has changed
+	void LevelChanged(int level);
+
+	//ends the game and tells the UI
+	void GameOver();
+
+	//updates the latency text and tells the UI
+	void LatencyChanged(const FString& text);
 
 	//if true, game will finish
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Game Over")
@@ -35,4 +62,28 @@ public:
 	//if false, will update the next tetromino UI in blueprint class
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Next Tetromino")
 	bool uiUpdated;
+
+	//called when the next tetromino queue changes, so the UI doesn't need to check uiUpdated every frame
+	UPROPERTY(BlueprintAssignable, Category = "Next Tetromino")
+	FOnNextQueueChanged OnNextQueueChanged;
+
+	//called when the score changes
+	UPROPERTY(BlueprintAssignable, Category = "Score")
+	FOnScoreChanged OnScoreChanged;
+
+	//called when the level changes
+	UPROPERTY(BlueprintAssignable, Category = "Score")
+	FOnLevelChanged OnLevelChanged;
+
+	//called when the game ends, so the UI doesn't need to check bGameOver every frame
+	UPROPERTY(BlueprintAssignable, Category = "Game Over")
+	FOnGameOver OnGameOver;
+
+	//p50/p90/p99 of the time from each input to its result being submitted for rendering, 1 line per input
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Latency")
+	FString latencyText;
+
+	//called when the latency text changes
+	UPROPERTY(BlueprintAssignable, Category = "Latency")
+	FOnLatencyChanged OnLatencyChanged;
 };
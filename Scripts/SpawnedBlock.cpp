@@ -6,8 +6,8 @@
 // Sets default values
 ASpawnedBlock::ASpawnedBlock()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	//blocks are only moved by the tetris block, so they never need to tick
+	PrimaryActorTick.bCanEverTick = false;
 
 	//creates the block visual as a cube and sets its relative location and scale
 	blockVisual = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("VisualRepresentation"));
@@ -29,13 +29,6 @@ void ASpawnedBlock::BeginPlay()
 	
 }
 
-// Called every frame
-void ASpawnedBlock::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
-
-}
-
 void ASpawnedBlock::MoveBlock(FVector NewLocation) {
 	//move block to NewLocation
 	SetActorLocation(NewLocation);
@@ -46,3 +39,9 @@ void ASpawnedBlock::SetColour(UMaterial* colour) {
 	blockVisual->SetMaterial(0, colour);
 }
 
+void ASpawnedBlock::SetActive(bool bActive) {
+	//hide pooled blocks and stop them colliding
+	SetActorHiddenInGame(!bActive);
+	SetActorEnableCollision(bActive);
+	landed = false;
+}
@@ -21,15 +21,15 @@ protected:
 	virtual void BeginPlay() override;
 
 public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
 	//moves block to the new location (i.e., NewLocation)
 	void MoveBlock(FVector NewLocation);
 
 	//changes block colour to colour passed through
 	void SetColour(UMaterial* colour);
 
+	//shows and enables the block when taken from the pool, or hides and disables it when returned
+	void SetActive(bool bActive);
+
 	//if true, player will no longer control block
 	bool landed;
 
@@ -4,6 +4,7 @@
 #include "TetrisBlock.h"
 #include "SpawnedBlock.h"
 #include "BlueprintFunctionality.h"
+#include "Components/InstancedStaticMeshComponent.h"
 
 // Sets default values
 ATetrisBlock::ATetrisBlock()
@@ -19,6 +20,53 @@ ATetrisBlock::ATetrisBlock()
 
 	//initialise overflow height, if not set in inspector
 	overflowHeight = 1.f;
+
+	//landed blocks are drawn by the stack meshes, so only the falling and ghost tetrominoes come from the pool
+	initialPoolSize = 8;
+
+	//pick a new random seed every game, unless set in inspector
+	seed = 0;
+
+	//record every game, and play replays back in real time
+	recordReplay = true;
+	playbackAtMaxSpeed = false;
+	playingReplay = false;
+	replayTime = 0.f;
+	scoreTextDirty = false;
+
+	//the player plays unless the AI is turned on in the inspector
+	aiPlayer = false;
+	aiTimeBudget = 0.002f;
+	aiBeamWidth = 32;
+	aiThreads = 2;
+	aiSearchStarted = false;
+
+	//run the game on its own thread at 120 steps per second, unless set in inspector
+	simulationThread = true;
+	simulationRate = 120;
+	simulationInputsSent = 0;
+	heldDirection = 0;
+	leftHeld = false;
+	rightHeld = false;
+
+	//guideline-like sideways timings, unless set in inspector
+	autoShiftDelay = 0.167f;
+	autoRepeatRate = 0.033f;
+
+	//measure input latency, updating the HUD every second, unless set in inspector
+	measureLatency = true;
+	latencyReportInterval = 1.f;
+	latencyReportTime = 0.f;
+
+	//undo is only for practice, so it is off unless set in inspector
+	practiceUndo = false;
+	maxUndos = 16;
+
+	//the landed stack uses the same cube as each spawned block
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> blockMeshAsset(TEXT("/Engine/BasicShapes/Cube.cube"));
+	if (blockMeshAsset.Succeeded()) {
+		blockMesh = blockMeshAsset.Object;
+	}
 }
 
 // Called when the game starts or when spawned
@@ -26,22 +74,20 @@ void ATetrisBlock::BeginPlay()
 {
 	Super::BeginPlay();
 
-	//initialisation of important variables
-	score = 0;
-
-	level = 1;
-
-	canRotate = true;
-
-	bSoftDrop = false;
-
-	bTBlock = false;
+	//set up the game rules using the playfield set in the inspector
+	TetrisCore::GameConfig config;
+	config.columns = FMath::RoundToInt((rightBoundary - leftBoundary) / 100.f) + 1;
+	config.spawnColumn = 5;
+	config.spawnRow = WorldToCell(FVector(xSpawnPoint, leftBoundary, zSpawnPoint)).Y;
+	config.overflowRow = FMath::FloorToInt((overflowHeight - groundLevel) / 100.f);
 
-	recentlyRotated = false;
-	tSpin = false;
-	largeOffset = false;
+	//use the seed set in the inspector so the game can be repeated, otherwise pick a new seed every game
+	config.seed = seed != 0 ? (uint64)seed : (uint64)FDateTime::Now().GetTicks();
+	config.stepsPerSecond = FMath::Max(1, simulationRate);
+	config.autoShiftDelay = FMath::Max(0.f, autoShiftDelay);
+	config.autoRepeatRate = FMath::Max(0.f, autoRepeatRate);
 
-	scoreMultiplier = 1.f;
+	game.Init(config);
 
 	//gets a reference to the camera actor in the scene
 	for (TObjectIterator<ACameraActor> act; act; ++act) {
@@ -72,11 +118,9 @@ void ATetrisBlock::BeginPlay()
 	LevelText->SetRelativeScale3D(FVector(1.f, 1.f, 1.f));
 	LevelText->SetTextRenderColor(FColor::Green);
 
-	//intialise score text to current score (which should be 0)
-	ScoreText->SetText(FText::FromString("Score = " + FString::FromInt(score)));
-
-	//initialise level text to starting level of 1
-	LevelText->SetText(FText::FromString("Level = " + FString::FromInt(level)));
+	//intialise score text to current score (which should be 0) and level text to starting level of 1
+	UpdateScore();
+	UpdateLevel();
 
 	//get the blueprint functionality class in the game world
 	GetBlueprintFunctionality();
@@ -84,316 +128,115 @@ void ATetrisBlock::BeginPlay()
 	//set game over to false
 	blueprintFunctionality->bGameOver = false;
 
-	//set initial gravity based on tetris algorithm: gravity = (0.8 - (level - 1))^level - 1
-	dropSpeed = FMath::Pow(0.8f -(((float)level - 1.f) * 0.007), (float)level - 1.f);
-
-	//initialise input timer so player can move tetromino sideways
-	inputTimer = 0.1f;
-
-	//fill colour pool will all block colours
-	colourPool = blockColours;
-
-	//get next 3 tetromino colours to spawn
-	for (int i = 0; i < 3; ++i) {
-		GetNextColourIndex();
-	}
-	
-	//spawn the first tetromino
-	SpawnTetromino();
-}
+	//spawn all blocks up front so none need spawning during play
+	FillBlockPool();
 
-void ATetrisBlock::GetNextColourIndex()
-{
-	int nextIndex = FMath::RandRange(0, colourPool.Num() - 1);
-	nextColours.Add(colourPool[nextIndex]);
+	//the ghost keeps the same 4 blocks all game
+	CreateGhostBlocks();
 
-	int nextBlockIndex = blockColours.Find(colourPool[nextIndex]);
-	blueprintFunctionality->nextTetrominoNumbers.Add(nextBlockIndex);
-	colourPool.RemoveAt(nextIndex);
-}
+	//create one instanced mesh per colour to draw the landed stack
+	CreateStackMeshes();
 
-// Called every frame
-void ATetrisBlock::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
+	//the AI searches on its own threads so it never holds up the game thread
+	if (aiPlayer) {
+		TetrisCore::AIConfig aiConfig;
+		aiConfig.beamWidth = FMath::Max(1, aiBeamWidth);
+		aiConfig.timeBudget = FMath::Max(0.f, aiTimeBudget);
 
-	//if game over, exit as block should no longer be functional
-	if (blueprintFunctionality->bGameOver) {
-		return;
+		aiPool = MakeUnique<TetrisCore::ThreadPool>(FMath::Max(1, aiThreads));
+		ai = MakeUnique<TetrisCore::LookaheadAI>(aiPool.Get(), aiConfig);
+		aiDriver = MakeUnique<TetrisCore::PlacementDriver>();
 	}
 
-	//increase timers by DeltaTime
-	dropTimer += DeltaTime;
-	inputTimer += DeltaTime;
-
-	//if 10 lines have been cleared, increase the level (and gravity)
-	if (linesCleared >= 10) {
-		linesCleared = 0;
-		UpdateLevel();
+	//snapshots are taken as every tetromino spawns, so make room for them all now rather than during play
+	if (practiceUndo) {
+		undoHistory.Reserve(FMath::Max(1, maxUndos) + 1);
 	}
 
-	//if the base of the tetromino isn't touching the ground
-	if (spawnedBlocks[lowestBlockIndex]->GetActorLocation().Z > groundLevel) {
-		//and the tetromino can move down 1 tetris unit
-		if (dropTimer > dropSpeed) {
-			//reset drop timer and set Z velocity to 1 tetris unit (100 Unreal units)
-			dropTimer = 0.f;
-			CurrentVelocity.Z = dropDist;
+	//play back the replay file if one is set, otherwise record this game so it can be replayed
+	if (replayFile.IsEmpty() || !StartReplay(config)) {
+		if (recordReplay) {
+			replayWriter.Begin(config);
 		}
-		else
-		{
-			//otherwise, set Z velocity to 0
-			CurrentVelocity.Z = 0.f;
-		}
-	}
-	else {
-		//otherwise, if landed for longer than lock delay (set at 0.5 seconds)
-		if (dropTimer > 0.5f) {
-			//lock the tetromino and spawn a new tetromino. Also, ensure gravity is reset to standard speed if soft dropped
-			RegisterAndCheckBlocks();
-			SlowDownDrop();
-			SpawnTetromino();
-			return;
-		}
-		else {
-			//otherwise, set Z velocity to 0 and allow horizontal movement during lock delay
-			CurrentVelocity.Z = 0.f;
-		}
-	}
-
-	//if block has moved (horizontally or vertically)
-	if (!CurrentVelocity.IsZero()) {
-		//get leftmost and rightmost positions of new location
-		FVector leftmostNewLoc = spawnedBlocks[leftmostBlockIndex]->GetActorLocation() + (CurrentVelocity);
-		FVector rightmostNewLoc = spawnedBlocks[rightmostBlockIndex]->GetActorLocation() + (CurrentVelocity);
-
-		FVector NewLocations[4];
 
-		//get the new location of each tetromino block
-		for (int i = 0; i < 4; ++i) {
-			NewLocations[i] = spawnedBlocks[i]->GetActorLocation() + (CurrentVelocity);
-		}
-
-		//requires a new check as otherwise other blocks in tetromino may not move down and get registered if a line is cleared
-		for (int i = 0; i < 4; ++i) {
-			//if one of the new block positions after movement is the same as an already landed block
-			if (landedBlockPos.Contains(NewLocations[i])) {
-				//ignore if Z velocity is 0
-				if (CurrentVelocity.Z == 0.f) {
-					return;
-				}
-
-				//else, check for a game over
-				if (spawnedBlocks[i]->GetActorLocation().Z > overflowHeight) {
-					blueprintFunctionality->bGameOver = true;
-					return;
-				}
-				
-				//otherwise, land the blocks, reset the gravity to non soft drop speed and spawn a new tetromino
-				RegisterAndCheckBlocks();
-				SlowDownDrop();
-				SpawnTetromino();
-				return;
-			}
+		//undo rewinds the game from this thread, so the game only goes on its own thread without it
+		if (simulationThread && !practiceUndo) {
+			StartSimulation(config);
 		}
-
-		//gets all blocks again. Seperate functionality so new loop is required
-		for(int i = 0; i < 4; ++i){
-			//if new horizontal position is within the level boundaries then move tetromino
-			if (leftmostNewLoc.Y >= leftBoundary && rightmostNewLoc.Y <= rightBoundary) {
-				spawnedBlocks[i]->MoveBlock(NewLocations[i]);
-
-			}
-			else {
-				//otherwise, block horizontal movement
-				CurrentVelocity.Y = 0.f;
-				//then get the new location based on the changed speed and move the block
-				NewLocations[i] = spawnedBlocks[i]->GetActorLocation() + CurrentVelocity;
-				spawnedBlocks[i]->MoveBlock(NewLocations[i]);
-			}
-		}
-
-		//sets recently rotated to false as last move was a drop/sideways movement
-		recentlyRotated = false;
-
-		//resets t spin bools if it was a T block
-		if (bTBlock) {
-			miniTSpin = false;
-			tSpin = false;
-		}
-
-		//if movement was soft dropped, increase score by 1
-		if (bSoftDrop) {
-			UpdateScore(1);
+		else {
+			//spawn the first tetromino
+			SpawnTetromino();
 		}
 	}
 }
 
-void ATetrisBlock::RegisterAndCheckBlocks()
+void ATetrisBlock::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	//initialise relevant variables
-	bool blocksRegistered = false;
-	rowsClearedInMove = 0;
-
-	//get all blocks in current tetromino
-	for (int j = 0; j < 4; ++j) {
-		//if not registered
-		if (!blocksRegistered) {
-			//add the current position of the block to landed block positions
-			landedBlockPos.Add(spawnedBlocks[j]->GetActorLocation());
-
-			//resets array so it can check the row of each landed block.
-			if (j >= 3) {
-				blocksRegistered = true;
-				j = -1;
-			}
+	Super::EndPlay(EndPlayReason);
 
-			continue;
-		}
+	//save the game if it was quit before game over. This also stops the simulation thread
+	SaveReplay();
+	simulation.Reset();
 
-		//checks row of each block in the tetromino for line clears
-		CheckRow(spawnedBlocks[j]);
+	if (measureLatency) {
+		SaveLatencyReport();
 	}
 
-	//if no lines were cleared
-	if (rowsClearedInMove < 1) {
-		//but it is a T tetromino
-		if (bTBlock) {
-			//if a mini T spin was performed, increase score by 100 * level
-			if (miniTSpin) {
-				UpdateScore(100 * level);
-			}
-			else if (tSpin) {
-				//otherwise, if a T spin was performed, increase score by 400 * level
-				UpdateScore(400 * level);
-			}
-		}
-		//exit as scoring as been added
-		return;
+	//the AI waits for any search still running before its pool is stopped
+	ai.Reset();
+	aiPool.Reset();
+}
+
+void ATetrisBlock::UpdateNextQueue() {
+	//copy the next 3 tetrominoes from the randomizer, reusing the array so it doesn't reallocate
+	blueprintFunctionality->nextTetrominoNumbers.Reset();
+	for (int i = 0; i < 3; ++i) {
+		blueprintFunctionality->nextTetrominoNumbers.Add((int)game.GetRandomizer().Peek(i));
 	}
 
-	//the calculated score added based on the move performed
-	float scoreIncrease = 0.f;
+	//tell the UI the next tetromino queue has changed
+	blueprintFunctionality->NextQueueChanged();
+}
 
-	//get the rows cleared in the move
-	switch (rowsClearedInMove) {
-	case 1:
-		if (bTBlock) {
-			//if 1 row was cleared and a mini T spin was performed
-			if (miniTSpin) {
-				//if another difficult move was performed before this move, set multiplier to 1.5
-				if (difficultMovePerformed) {
-					scoreMultiplier = 1.5f;
-				}
-				
-				//get score increase based on base value of 200, multiplied by the current level and by the score multiplier and update the score
-				scoreIncrease = 200.f * (float)level * scoreMultiplier;
-				UpdateScore((int)scoreIncrease);
-				//set difficult move performed to true, making player eligable for multiplier if they before another one next
-				difficultMovePerformed = true;
-				break;
-			}
-			//otherwise, if 1 row was cleared and a T spin was performed
-			if (tSpin) {
-				//increase multiplier if performed after another difficult move
-				if (difficultMovePerformed) {
-					scoreMultiplier = 1.5f;
-				}
+// Called every frame
+void ATetrisBlock::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
 
-				//increase score by base value of 800, multiplied by current level and score multiplier
-				scoreIncrease = 800.f * (float)level * scoreMultiplier;
-				UpdateScore((int)scoreIncrease);
-				//make player eligable for multiplier if they perform another difficult move next
-				difficultMovePerformed = true;
-				break;
-			}
+	//if game over, skip the game as block should no longer be functional
+	if (!game.IsGameOver()) {
+		if (playingReplay) {
+			//the replay decides what happens rather than the player
+			AdvanceReplay(DeltaTime);
 		}
+		else if (simulation.IsValid()) {
+			//the simulation thread has been stepping on its own, so show where it has got to
+			PresentSimulation();
 
-		//otherwise, break the difficult move streak and reset multiplier
-		difficultMovePerformed = false;
-		scoreMultiplier = 1.f;
-		//and update score by a base value of 100 multiplied by level
-		UpdateScore(100 * level);
-		break;
-	case 2:
-		if (bTBlock) {
-			//if 2 rows were cleared and a mini T spin was performed
-			if (miniTSpin) {
-				//increase multiplier if back-to-back with another difficult move
-				if (difficultMovePerformed) {
-					scoreMultiplier = 1.5f;
-				}
-
-				//increase score by base value of 400, multiplied by level and score multiplier
-				scoreIncrease = 400.f * (float)level * scoreMultiplier;
-				UpdateScore((int)scoreIncrease);
-
-				//make player eligable for multiplier if next move is difficult
-				difficultMovePerformed = true;
-				break;
-			}
-			//otherwise, if 2 rows were cleared and a T spin was performed
-			if (tSpin) {
-				//if back-to-back with another difficult move, increase multiplier
-				if (difficultMovePerformed) {
-					scoreMultiplier = 1.5f;
-				}
-				
-				//increase score by base value of 1200 multiplied by level and score multiplier
-				scoreIncrease = 1200.f * (float)level * scoreMultiplier;
-				UpdateScore((int)scoreIncrease);
-
-				//make player eligable for multiplier if they perform another difficult move next
-				difficultMovePerformed = true;
-				break;
+			//the AI reads the mirror, so it waits until the mirror shows the inputs it already pressed rather than pressing them again
+			if (ai.IsValid() && !game.IsGameOver() && simulationFrame.commandsApplied == simulationInputsSent) {
+				RunAI();
 			}
 		}
-
-		//otherwise, 2 rows were cleared so break difficult move streak and reset multiplier
-		difficultMovePerformed = false;
-		scoreMultiplier = 1.f;
-		//then increase score by base value of 300 multiplied by level
-		UpdateScore(300 * level);
-		break;
-	case 3:
-		if (bTBlock) {
-			//if 3 lines were cleared and a T spin was performed
-			if (tSpin) {
-				//if last move was also difficult then increase multiplier
-				if (difficultMovePerformed) {
-					scoreMultiplier = 1.5f;
-				}
-
-				//increase score by base value of 1600 multiplied by level and score multiplier
-				scoreIncrease = 1600.f * (float)level * scoreMultiplier;
-				UpdateScore((int)scoreIncrease);
-				//make player eligable for back-to-back bonus if another difficult move is performed next
-				difficultMovePerformed = true;
-				break;
+		else {
+			//the AI presses its inputs before the game steps, the same as a player's inputs arriving during the frame
+			if (ai.IsValid()) {
+				RunAI();
 			}
-		}
 
-		//else, 3 lines were cleared so break difficult move streak and reset multiplier
-		difficultMovePerformed = false;
-		scoreMultiplier = 1.f;
-		//then increase score by base value of 500 multiplied by the current level
-		UpdateScore(500 * level);
-		break;
-	case 4:
-		//if 4 lines were cleared (i.e., a tetris), if previous move was difficult, increase multiplier to 1.5
-		if (difficultMovePerformed) {
-			scoreMultiplier = 1.5f;
+			//advance gravity, sideways movement and lock delay, then update the scene to match
+			game.Tick(DeltaTime);
+			HandleGameEvents();
 		}
+	}
 
-		//then increase score by base value of 800, multiplied by level and score multiplier
-		scoreIncrease = 800.f * (float)level * scoreMultiplier;
-		UpdateScore(scoreIncrease);
+	//building the score text allocates, so do it at most once per frame however many times the score changed
+	if (scoreTextDirty) {
+		UpdateScore();
+	}
 
-		//and make player eligable for back-to-back multiplier if next move is difficult
-		difficultMovePerformed = true;
-		break;
-	default:
-		break;
+	if (measureLatency) {
+		PresentLatency(DeltaTime);
 	}
 }
 
@@ -402,8 +245,16 @@ void ATetrisBlock::SetupPlayerInputComponent(UInputComponent* PlayerInputCompone
 {
 	Super::SetupPlayerInputComponent(PlayerInputComponent);
 
-	//moves left when left key is pressed and right when right key is pressed
-	InputComponent->BindAxis("MoveHorizontally", this, &ATetrisBlock::MoveHorizontally);
+	//the AI has the controls, so the player's input isn't bound (otherwise the released axis would cancel the AI's moves every frame)
+	if (aiPlayer) {
+		return;
+	}
+
+	//moves left when left key is pressed and right when right key is pressed. Bound to presses rather than an axis, so a tap shorter than a frame still moves
+	InputComponent->BindAction("MoveLeft", IE_Pressed, this, &ATetrisBlock::PressLeft);
+	InputComponent->BindAction("MoveLeft", IE_Released, this, &ATetrisBlock::ReleaseLeft);
+	InputComponent->BindAction("MoveRight", IE_Pressed, this, &ATetrisBlock::PressRight);
+	InputComponent->BindAction("MoveRight", IE_Released, this, &ATetrisBlock::ReleaseRight);
 
 	//soft drops when down key is pressed
 	InputComponent->BindAction("IncreaseGravity", IE_Pressed, this, &ATetrisBlock::SpeedUpDrop);
@@ -419,682 +270,653 @@ void ATetrisBlock::SetupPlayerInputComponent(UInputComponent* PlayerInputCompone
 
 	//hard drops when space bar is pressed
 	InputComponent->BindAction("HardDrop", IE_Pressed, this, &ATetrisBlock::HardDrop);
+
+	//takes back the last tetromino in practice mode
+	if (practiceUndo) {
+		InputComponent->BindAction("Undo", IE_Pressed, this, &ATetrisBlock::Undo);
+	}
+}
+
+void ATetrisBlock::PressLeft() {
+	leftHeld = true;
+	MoveHorizontally(-1.f);
+}
+
+void ATetrisBlock::ReleaseLeft() {
+	leftHeld = false;
+
+	//go back to moving right if it is still held
+	MoveHorizontally(rightHeld ? 1.f : 0.f);
+}
+
+void ATetrisBlock::PressRight() {
+	rightHeld = true;
+	MoveHorizontally(1.f);
+}
+
+void ATetrisBlock::ReleaseRight() {
+	rightHeld = false;
+
+	//go back to moving left if it is still held
+	MoveHorizontally(leftHeld ? -1.f : 0.f);
 }
 
 void ATetrisBlock::MoveHorizontally(float axisValue) {
-	//input only accepted every 0.1 seconds
-	if (inputTimer >= 0.1f) {
-		//if accepted, then set Y value of velocity to 100 or -100 based on direction
-		CurrentVelocity.Y = FMath::Clamp(axisValue, -1.f, 1.f) * 100.f;
-		inputTimer = 0.f;
-	}
-	else {
-		//otherwise, set Y velocity to 0
-		CurrentVelocity.Y = 0.f;
+	//hold left or right based on direction. The game moves the tetromino as soon as a direction is pressed, then on its own after the auto shift delay
+	int direction = FMath::RoundToInt(FMath::Clamp(axisValue, -1.f, 1.f));
+
+	//only pass it on when the direction changes to keep the replay small
+	if (direction != heldDirection) {
+		heldDirection = direction;
+		ApplyInput(TetrisCore::InputType::Horizontal, direction);
 	}
 }
 
-void ATetrisBlock::SpawnTetromino() {
-	//if colour pool is empty then reset it
-	if (colourPool.Num() < 1) {
-		colourPool = blockColours;
-	}
-
-	FVector blockPositions[4];
-	//set position of centermost block to 5 tetris units from left boundary and 1 tetris unit above playfield
-	blockPositions[0] = FVector(xSpawnPoint, leftBoundary + 500.0f, zSpawnPoint);
-	//initialise variables
-	rotationPos = 0;
-	isIBlock = false;
-	bTBlock = false;
-	miniTSpin = false;
-	tSpin = false;
-
-	//get the next block colour
-	UMaterial* blockColour = nextColours[0];
-
-	//get the index of the colour from block colours
-	int blockColourIndex = blockColours.Find(nextColours[0]);
-
-	//remove the next colour index as it will be spawned from both index arrays
-	nextColours.RemoveAt(0);
-	blueprintFunctionality->nextTetrominoNumbers.RemoveAt(0);
-
-	//get the colour 3rd in the spawn queue
-	GetNextColourIndex();
-
-	//set ui updated to false so next tetromino queue can be updated
-	blueprintFunctionality->uiUpdated = false;
-
-	//get the index of the block from blockColours
-	switch (blockColourIndex) {
-	case 0:
-		//if 0, tetromino is blue so spawn a J tetromino
-		blockPositions[1] = blockPositions[0] + FVector(0.f, -100.f, 0.f);
-		blockPositions[2] = blockPositions[0] + FVector(0.f, -100.f, 100.f);
-		blockPositions[3] = blockPositions[0] + FVector(0.f, 100.f, 0.f);
-
-		//get leftmost, rightmost indexes and origin for rotations
-		leftmostBlockIndex = 1;
-		rightmostBlockIndex = 3;
-		tetriminoOriginOffset = FVector(0.f, 0.f, 0.f);
-		break;
-	case 1:
-		//if 1, tetromino is green so spawn an S tetromino
-		blockPositions[1] = blockPositions[0] + FVector(0.f, -100.f, 0.f);
-		blockPositions[2] = blockPositions[0] + FVector(0.f, 0.f, 100.f);
-		blockPositions[3] = blockPositions[0] + FVector(0.f, 100.f, 100.f);
-		leftmostBlockIndex = 1;
-		rightmostBlockIndex = 3;
-		tetriminoOriginOffset = FVector(0.f, 0.f, 0.f);
-		break;
-	case 2:
-		//if 2, tetromino is red so spawn a Z tetromino
-		blockPositions[1] = blockPositions[0] + FVector(0.f, 100.f, 0.f);
-		blockPositions[2] = blockPositions[0] + FVector(0.f, 0.f, 100.f);
-		blockPositions[3] = blockPositions[0] + FVector(0.f, -100.f, 100.f);
-		leftmostBlockIndex = 3;
-		rightmostBlockIndex = 1;
-		tetriminoOriginOffset = FVector(0.f, 0.f, 0.f);
-		break;
-	case 3:
-		//if 3, tetromino is yellow so spawn an O tetromino
-		blockPositions[1] = blockPositions[0] + FVector(0.f, 0.f, 100.f);
-		blockPositions[2] = blockPositions[0] + FVector(0.f, 100.f, 100.f);
-		blockPositions[3] = blockPositions[0] + FVector(0.f, 100.f, 0.f);
-		leftmostBlockIndex = 0;
-		rightmostBlockIndex = 2;
-		tetriminoOriginOffset = FVector(0.f, 50.f, 50.f);
-		break;
-	case 4:
-		//if 4, tetromino is light blue so spawn an I tetromino
-		blockPositions[1] = blockPositions[0] + FVector(0.f, -100.f, 0.f);
-		blockPositions[2] = blockPositions[0] + FVector(0.f, 100.f, 0.f);
-		blockPositions[3] = blockPositions[0] + FVector(0.f, 200.f, 0.f);
-		leftmostBlockIndex = 1;
-		rightmostBlockIndex = 3;
-		tetriminoOriginOffset = FVector(0.f, 50.f, -50.f);
-		//set to true so class will check for I wall kicks rather than standard wall kicks
-		isIBlock = true;
-		break;
-	case 5:
-		//if 5, tetromino is orange so spawn a L tetromino
-		blockPositions[1] = blockPositions[0] + FVector(0.f, -100.f, 0.f);
-		blockPositions[2] = blockPositions[0] + FVector(0.f, 100.f, 0.f);
-		blockPositions[3] = blockPositions[0] + FVector(0.f, 100.f, 100.f);
-		leftmostBlockIndex = 1;
-		rightmostBlockIndex = 2;
-		tetriminoOriginOffset = FVector(0.f, 0.f, 0.f);
-		break;
-	case 6:
-		//if 6, tetromino is magenta so spawn a T tetromino
-		blockPositions[1] = blockPositions[0] + FVector(0.f, -100.f, 0.f);
-		blockPositions[2] = blockPositions[0] + FVector(0.f, 0.f, 100.f);
-		blockPositions[3] = blockPositions[0] + FVector(0.f, 100.f, 0.f);
-		leftmostBlockIndex = 1;
-		rightmostBlockIndex = 3;
-		tetriminoOriginOffset = FVector(0.f, 0.f, 0.f);
-		//set to true so class will check for T spins
-		bTBlock = true;
-		break;
-	default:
-		break;
-	}
-	//set base block to 0 as center block is always at base from initial rotation
-	lowestBlockIndex = 0;
-
-	//spawn 4 blocks at the set positions based on the randomise colour
-	for (int i = 0; i < 4; ++i) {
-		SpawnBlock(blockPositions[i], blockColour, i);
+void ATetrisBlock::ApplyInput(TetrisCore::InputType type, int value) {
+	//the player can't take over while a replay is playing
+	if (playingReplay) {
+		return;
 	}
-}
 
-void ATetrisBlock::SpawnBlock(FVector position, UMaterial* blockColour, int blockIndex) {
-	//spawns a block and adds it to current blocks array based on the current index
-	spawnedBlocks[blockIndex] = (ASpawnedBlock*)GWorld->SpawnActor(ASpawnedBlock::StaticClass());
-	//add to all blocks array
-	allBlocks.Add(spawnedBlocks[blockIndex]);
+	//the engine has just handed the input over, so its latency is timed from here
+	TetrisCore::LatencyTracker::Clock::time_point receivedTime = TetrisCore::LatencyTracker::Clock::now();
+	TetrisCore::LatencyAction action = TetrisCore::GetLatencyAction(type, value);
 
-	//set position and colour based on parameters passed through
-	spawnedBlocks[blockIndex]->SetActorLocation(position);
-	spawnedBlocks[blockIndex]->SetColour(blockColour);
-}
+	//the simulation thread applies the input before its next step, and records it then
+	if (simulation.IsValid()) {
+		if (simulation->PushInput(type, value)) {
+			simulationInputsSent++;
 
-void ATetrisBlock::CheckRow(ASpawnedBlock* currentBlock) {
-	int blocksOnRow = 0;
-	TArray<ASpawnedBlock*> blocksToDestroy;
-	TArray<ASpawnedBlock*> blocksToMoveDown;
-
-	//gets every block currently in game
-	for (int i = 0; i < allBlocks.Num(); ++i) {
-		//if the Z position of the current block is the same as the current array block
-		if (allBlocks[i]->GetActorLocation().Z == currentBlock->GetActorLocation().Z) {
-			//increment row by 1 and add to blocks to destroy
-			blocksOnRow++;
-			blocksToDestroy.Add(allBlocks[i]);
-		}
-		else if (allBlocks[i]->GetActorLocation().Z > currentBlock->GetActorLocation().Z) {
-			//if array block is above current blocks location, add to move down array
-			blocksToMoveDown.Add(allBlocks[i]);
+			//every input sent is numbered, measured or not, so the numbers match the inputs the simulation thread says it applied
+			if (measureLatency) {
+				latency.Received(action, receivedTime);
+			}
 		}
+		return;
 	}
 
-	//if 10 blocks are found in the row
-	if (blocksOnRow >= 10) {
-		//destroy all blocks in the row and move the above blocks down by 1
-		RemoveBlocks(blocksToDestroy);
-		ShiftBlocksDown(blocksToMoveDown);
-		//and increment rows cleared in move
-		rowsClearedInMove++;
+	//inputs are recorded against the amount of steps run, so they happen at the same point in the game when replayed
+	replayWriter.Record(game.GetStepCount(), type, value);
+	game.ApplyInput(type, value);
+
+	if (measureLatency) {
+		latency.Applied(latency.Received(action, receivedTime), TetrisCore::LatencyTracker::Clock::now());
 	}
+
+	HandleGameEvents();
 }
 
-void ATetrisBlock::RemoveBlocks(TArray<ASpawnedBlock*> blocks) {
-	//destroy all blocks passed through and remove them from respective arrays
-	for (int i = 0; i < blocks.Num(); ++i) {
-		allBlocks.Remove(blocks[i]);
-		landedBlockPos.Remove(blocks[i]->GetActorLocation());
-		blocks[i]->Destroy();
+bool ATetrisBlock::StartReplay(const TetrisCore::GameConfig& config) {
+	FString path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Replays"), replayFile);
+	if (!FFileHelper::LoadFileToArray(replayData, *path)) {
+		UE_LOG(LogTemp, Warning, TEXT("Couldn't load replay %s"), *path);
+		return false;
+	}
+
+	//restarts the game with the seed the replay was recorded with
+	if (!replayPlayer.Start(game, config, replayData.GetData(), replayData.Num())) {
+		UE_LOG(LogTemp, Warning, TEXT("%s isn't a valid replay"), *path);
+		return false;
 	}
 
-	//increment lines cleared
-	linesCleared++;
+	playingReplay = true;
+	replayTime = 0.f;
+
+	//spawn the first tetromino, then give it blocks which are kept for the whole replay
+	replayPlayer.Advance(game, 0);
+	for (int i = 0; i < 4; ++i) {
+		SpawnBlock(FVector::ZeroVector, nullptr, i);
+	}
+
+	ShowLatestState();
+	return true;
 }
 
-void ATetrisBlock::ShiftBlocksDown(TArray<ASpawnedBlock*> blocks) {
-	//shift all blocks passed through down by 1 tetris unit and update location in respective arrays
-	for (int i = 0; i < blocks.Num(); ++i) {
-		int indexToChange = landedBlockPos.Find(blocks[i]->GetActorLocation());
-		FVector NewLoc = blocks[i]->GetActorLocation() + FVector(0.f, 0.f, dropDist);
-		blocks[i]->SetActorLocation(NewLoc);
-		
-		landedBlockPos[indexToChange] = blocks[i]->GetActorLocation();
-		
+void ATetrisBlock::AdvanceReplay(float DeltaTime) {
+	if (replayPlayer.IsFinished()) {
+		return;
+	}
+
+	if (playbackAtMaxSpeed) {
+		//play the whole replay in one go and report how long it took
+		double startTime = FPlatformTime::Seconds();
+		replayPlayer.Advance(game, MAX_uint64);
+		UE_LOG(LogTemp, Log, TEXT("Replay played %llu steps in %f seconds"), game.GetStepCount(), FPlatformTime::Seconds() - startTime);
 	}
+	else {
+		replayTime += DeltaTime;
+		replayPlayer.Advance(game, (uint64)((double)replayTime * (double)game.GetConfig().stepsPerSecond));
+	}
+
+	ShowLatestState();
 }
 
-void ATetrisBlock::SpeedUpDrop() {
-	//increase gravity to 0.01 (i.e., very fast drop) and set bool to true so score is increased
-	dropSpeed = 0.01f;
-	bSoftDrop = true;
+void ATetrisBlock::StartSimulation(const TetrisCore::GameConfig& config) {
+	//the mirror starts as the same game, so the scene can be set up before the first frame arrives
+	game.Init(config);
+	simulationInputsSent = 0;
+	simulationFrame.commandsApplied = 0;
+
+	//tetrominoes can spawn and lock between frames, so the falling tetromino keeps the same 4 blocks and they are recoloured instead
+	for (int i = 0; i < 4; ++i) {
+		SpawnBlock(FVector::ZeroVector, nullptr, i);
+	}
+
+	simulation = MakeUnique<TetrisCore::SimulationThread>();
+	simulation->Start(config, recordReplay ? &replayWriter : nullptr);
+
+	//the first frame is sent before the thread starts, so the first tetromino and the queue can be shown straight away
+	PresentSimulation();
+	UpdateNextQueue();
 }
 
-void ATetrisBlock::SlowDownDrop() {
-	//reset drop speed to current speed based on algorithm
-	dropSpeed = FMath::Pow(0.8f - (((float)level - 1.f) * 0.007), (float)level - 1.f);
-	bSoftDrop = false;
+bool ATetrisBlock::PresentSimulation() {
+	if (!simulation->TakeLatestFrame(simulationFrame)) {
+		return false;
+	}
+
+	//the times the inputs in this frame were applied, taken even when not measuring so they don't fill the queue
+	TetrisCore::SimulationAppliedInput appliedInput;
+	while (simulation->TakeAppliedInput(simulationFrame.commandsApplied, appliedInput)) {
+		if (measureLatency) {
+			latency.Applied(appliedInput.input, appliedInput.time);
+		}
+	}
+
+	//a new tetromino needs a new search from the AI
+	if (simulationFrame.state.events & TetrisCore::EventPieceLocked) {
+		aiSearchStarted = false;
+		if (aiDriver.IsValid()) {
+			aiDriver->Stop();
+		}
+	}
+
+	//the frame carries every event since the last one, so the mirror hands them on as if it had played them itself
+	game.RestoreState(simulationFrame.state, simulationFrame.state.events);
+	ShowLatestState();
+
+	if (game.IsGameOver()) {
+		SaveReplay();
+	}
+
+	return true;
 }
 
-void ATetrisBlock::HardDrop() {
-	//if not game over
-	if (!blueprintFunctionality->bGameOver) {
-		//calculate the lowest Z position that the tetromino can land at
-		float lowestZPosition = GetLowestZPosition();
+void ATetrisBlock::ShowLatestState() {
+	uint32 events = game.TakeEvents();
 
-		//calculate the distance to drop based on the lowest Z position
-		float distanceToDrop = lowestZPosition - spawnedBlocks[ZCompareIndex]->GetActorLocation().Z;
+	if (events & TetrisCore::EventPieceLocked) {
+		//any amount of tetrominoes can lock in one go, so redraw the whole stack rather than adding the last tetromino
+		RebuildStackMeshes();
+		UpdateNextQueue();
+	}
 
-		//move blocks to landed position
+	if (events & (TetrisCore::EventPieceLocked | TetrisCore::EventPieceMoved)) {
+		//the falling tetromino may be a new one, so recolour the blocks as well as moving them
+		int pieceType = (int)game.GetPiece().type;
 		for (int i = 0; i < 4; ++i) {
-			FVector NewLoc = spawnedBlocks[i]->GetActorLocation() + FVector(0.f, 0.f, distanceToDrop);
-			spawnedBlocks[i]->SetActorLocation(NewLoc);
+			spawnedBlocks[i]->SetColour(blockColours.IsValidIndex(pieceType) ? blockColours[pieceType] : nullptr);
 		}
 
-		//check blocks for line clears
-		RegisterAndCheckBlocks();
+		UpdateFallingBlocks();
+	}
+
+	if (events & TetrisCore::EventGhostMoved) {
+		UpdateGhostBlocks();
+	}
 
-		//increase score based on tetris units moved multipled by 2
-		UpdateScore(2 * (int)(-distanceToDrop / 100.f));
-		
-		//spawn a new tetromino
-		SpawnTetromino();
+	//soft drop changes the score every row, so the text is only rebuilt once at the end of the frame
+	if (events & TetrisCore::EventScoreChanged) {
+		scoreTextDirty = true;
+	}
+
+	if (events & TetrisCore::EventLevelChanged) {
+		UpdateLevel();
+	}
+
+	if (game.IsGameOver()) {
+		blueprintFunctionality->GameOver();
 	}
 }
 
-float ATetrisBlock::GetLowestZPosition() {
-	FVector newLocation;
+void ATetrisBlock::SaveReplay() {
+	//the simulation thread records the inputs as it applies them, so it has to stop before the recording can be finished
+	uint64 stepCount = game.GetStepCount();
+	if (simulation.IsValid()) {
+		simulation->Stop();
+		stepCount = simulation->GetGame().GetStepCount();
+	}
 
-	//set to ground level initially
-	float lowestZPosition = groundLevel;
-	//the index of the tetromino block that is being compared, set to the lowest block initially
-	ZCompareIndex = lowestBlockIndex;
+	//nothing to save if not recording, or if the replay has already been saved
+	if (!replayWriter.IsRecording()) {
+		return;
+	}
 
-	for (int i = 0; i < 4; ++i) {
-		//start lowest position at overflow height
-		float tempZPos = overflowHeight;
-
-		//then get the Z compare index
-		//if i = 0 and Y position is same as ZCompareIndex block, no check is needed as the lowest position was already found on this column
-		if (i != 0 && spawnedBlocks[ZCompareIndex]->GetActorLocation().Y == spawnedBlocks[i]->GetActorLocation().Y) {
-			//but if the Z position of the current block is lower than the block at ZCompareIndex, change Z compare index to this new position
-			if (spawnedBlocks[i]->GetActorLocation().Z < spawnedBlocks[ZCompareIndex]->GetActorLocation().Z) {
-				ZCompareIndex = i;
-			}
-			continue;
-		}
-		while (tempZPos >= groundLevel) {
-			//increment lowest position downwards until the ground level is reached
-			tempZPos -= 100.f;
+	replayWriter.Finish(stepCount);
 
-			//but stop if a block is found on this Y position
-			if (landedBlockPos.Contains(FVector(spawnedBlocks[i]->GetActorLocation().X, spawnedBlocks[i]->GetActorLocation().Y, tempZPos))) {
-				break;
-			}
-		}
+	TArray<uint8> fileData;
+	fileData.Append(replayWriter.GetData().data(), (int32)replayWriter.GetData().size());
 
-		//then, if the lowest Z position is lower than the lowest position found for the current block (+100 (1 tetris unit) to account for being above the block/ground)
-		if (lowestZPosition < tempZPos + 100.f) {
-			//update lowest Z position and Z compare index
-			lowestZPosition = tempZPos + 100.f;
-			ZCompareIndex = i;
-		}
+	FString path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Replays"), FDateTime::Now().ToString() + TEXT(".replay"));
+	if (FFileHelper::SaveArrayToFile(fileData, *path)) {
+		UE_LOG(LogTemp, Log, TEXT("Saved replay to %s"), *path);
+	}
+	else {
+		UE_LOG(LogTemp, Warning, TEXT("Couldn't save replay to %s"), *path);
 	}
-	//return the new Z position of the lowest block in the tetromino
-	return lowestZPosition;
 }
 
-void ATetrisBlock::RotateAntiClockwise() {
-	//if game over, disable controls by returning
-	if (blueprintFunctionality->bGameOver) {
+void ATetrisBlock::PresentLatency(float DeltaTime) {
+	//the falling, ghost and stack blocks have been moved for every input applied so far, and their transforms are sent to the renderer
+	//at the end of this frame. The simulation thread may not have applied the latest inputs yet, so only the ones in its frame count
+	uint64 shownInputs = simulation.IsValid() ? simulationFrame.commandsApplied : latency.GetReceivedCount();
+	latency.Presented(shownInputs, TetrisCore::LatencyTracker::Clock::now());
+
+	//building the text allocates, so the HUD is only updated every latencyReportInterval seconds
+	latencyReportTime += DeltaTime;
+	if (latencyReportTime >= latencyReportInterval) {
+		latencyReportTime = 0.f;
+		ReportLatency();
+	}
+}
+
+void ATetrisBlock::ReportLatency() {
+	if (!blueprintFunctionality) {
 		return;
 	}
-	//set points very high/low to make it easy to change them when comparing
-	float lowestYPoint = 1e+10;
-	float highestYPoint = -1e+10;
-	float lowestZpoint = 1e+10;
-	TArray<FVector> newPositions;
-	//initialise bools to false
-	bool shouldWallKick = false;
-	tSpin = false;
-	miniTSpin = false;
-	//calculate origin of rotation based on the first block and its offset to the center (usually 0 with exception of I and O blocks)
-	tetriminoOrigin = spawnedBlocks[0]->GetActorLocation() + tetriminoOriginOffset;
-	//allow rotations for now
-	canRotate = true;
-	for (int i = 0; i < 4; ++i) {
-		//code adapted from McGuire (2017)
-		//get offset from rotation origin of each block
-		FVector originOffset = spawnedBlocks[i]->GetActorLocation() - tetriminoOrigin;
-		//get position that block will rotate to, relative to x axis
-		FVector rotatedPos = originOffset.RotateAngleAxis(90.f, FVector(1.f, 0.f, 0.f));
-		//get final position of block, relative to the rotation origin of the tetrimino
-		FVector newPosition = rotatedPos + tetriminoOrigin;
-		//round new positions to nearest int, as rotation often offsets block positions slightly, creating collision issues
-		FMath::RoundToInt(newPosition.Y);
-		FMath::RoundToInt(newPosition.Z);
-
-		//if the rotation would result in the block clipping through walls or blocks then wall kick
-		if (landedBlockPos.Contains(newPosition) || newPosition.Y < leftBoundary || newPosition.Y > rightBoundary || newPosition.Z < groundLevel) {
-			shouldWallKick = true;
+
+	//1 line per input that has been measured, in milliseconds
+	FString text;
+	for (int action = 0; action < TetrisCore::NumLatencyActions; ++action) {
+		const TetrisCore::LatencyHistogram& histogram = latency.GetHistogram((TetrisCore::LatencyAction)action, TetrisCore::LatencyStage::Total);
+		if (histogram.GetCount() == 0) {
+			continue;
 		}
 
-		//get the rotated position of the block
-		newPositions.Add(newPosition);
+		text += FString::Printf(TEXT("%s p50 %.1f p90 %.1f p99 %.1f ms\n"), ANSI_TO_TCHAR(TetrisCore::GetLatencyActionName((TetrisCore::LatencyAction)action)),
+			histogram.GetPercentile(0.5) / 1e6, histogram.GetPercentile(0.9) / 1e6, histogram.GetPercentile(0.99) / 1e6);
 	}
 
-	//if wall kick = true
-	if (shouldWallKick) {
-		switch(rotationPos){
-		case 0:
-			//if 0, block was rotated from 0 (initial rotation), so wall kick based on 0 anti-clockwise offsets. If I block, wall kick based on respective I offsets
-			if (isIBlock) {
-				WallKick(newPositions, iAntiClockwise0WallKickOffsets);
-				break;
-			}
+	blueprintFunctionality->LatencyChanged(text);
+}
 
-			WallKick(newPositions, antiClockwise0WallKickOffsets);
-			break;
-		case 1:
-			//if 1, block was rotated from R (clockwise position), so wall kick based on R anti-clockwise offsets. If I block, wall kick based on respective I offsets
-			if (isIBlock) {
-				WallKick(newPositions, iAntiClockwiseRWallKickOffsets);
-				break;
-			}
+void ATetrisBlock::SaveLatencyReport() {
+	//nothing to save if no inputs were measured
+	if (latency.GetReceivedCount() == 0) {
+		return;
+	}
 
-			WallKick(newPositions, antiClockwiseRWallKickOffsets);
-			break;
-		case 2:
-			if (isIBlock) {
-				//if 2, block was rotated from 2 (opposite rotation), so wall kick based on 2 anti-clockwise offsets. If I block, wall kick based on respective I offsets
-				WallKick(newPositions, iAntiClockwise2WallKickOffsets);
-				break;
-			}
+	//the percentiles go to the log, and every non empty bucket of every histogram goes to a CSV file so the full distribution can be plotted
+	FString csv = TEXT("action,stage,min_ns,max_ns,count\n");
 
-			WallKick(newPositions, antiClockwise2WallKickOffsets);
-			break;
-		case 3:
-			//if 1, block was rotated from L (anti-clockwise position), so wall kick based on L anti-clockwise offsets. If I block, wall kick based on respective I offsets
-			if (isIBlock) {
-				WallKick(newPositions, iAntiClockwiseLWallKickOffsets);
-				break;
+	for (int action = 0; action < TetrisCore::NumLatencyActions; ++action) {
+		for (int stage = 0; stage < TetrisCore::NumLatencyStages; ++stage) {
+			const TetrisCore::LatencyHistogram& histogram = latency.GetHistogram((TetrisCore::LatencyAction)action, (TetrisCore::LatencyStage)stage);
+			if (histogram.GetCount() == 0) {
+				continue;
 			}
 
-			WallKick(newPositions, antiClockwiseLWallKickOffsets);
-			break;
-		default:
-			break;
-		}
-	}
+			FString actionName = ANSI_TO_TCHAR(TetrisCore::GetLatencyActionName((TetrisCore::LatencyAction)action));
+			FString stageName = ANSI_TO_TCHAR(TetrisCore::GetLatencyStageName((TetrisCore::LatencyStage)stage));
+			UE_LOG(LogTemp, Log, TEXT("Latency %s %s: %llu inputs, p50 %.2fms p90 %.2fms p99 %.2fms max %.2fms"), *actionName, *stageName, histogram.GetCount(),
+				histogram.GetPercentile(0.5) / 1e6, histogram.GetPercentile(0.9) / 1e6, histogram.GetPercentile(0.99) / 1e6, histogram.GetMax() / 1e6);
 
-	//if canRotate bool is still true
-	if (canRotate) {
-		//then find the leftmost, rightmost and lowest blocks in the tetromino after the rotation
-		for (int i = 0; i < 4; ++i) {
-			if (newPositions[i].Y < lowestYPoint) {
-				lowestYPoint = newPositions[i].Y;
-				leftmostBlockIndex = i;
-			}
-			if (newPositions[i].Y > highestYPoint) {
-				highestYPoint = newPositions[i].Y;
-				rightmostBlockIndex = i;
-			}
-			if (newPositions[i].Z < lowestZpoint) {
-				lowestZpoint = newPositions[i].Z;
-				lowestBlockIndex = i;
+			for (int bucket = 0; bucket < TetrisCore::LatencyHistogram::NumBuckets; ++bucket) {
+				if (histogram.GetBucketCount(bucket) > 0) {
+					csv += FString::Printf(TEXT("%s,%s,%llu,%llu,%llu\n"), *actionName, *stageName, TetrisCore::LatencyHistogram::GetBucketMin(bucket),
+						TetrisCore::LatencyHistogram::GetBucketMax(bucket), histogram.GetBucketCount(bucket));
+				}
 			}
-			//and set the new location of the block
-			spawnedBlocks[i]->SetActorLocation(newPositions[i]);
-			//end of adapted code
 		}
+	}
 
-		//change origin offset based on new position of tetromino (only changes for I and O tetrominoes)
-		tetriminoOriginOffset = tetriminoOrigin - spawnedBlocks[0]->GetActorLocation();
+	FString path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Latency"), FDateTime::Now().ToString() + TEXT(".csv"));
+	if (FFileHelper::SaveStringToFile(csv, *path)) {
+		UE_LOG(LogTemp, Log, TEXT("Saved latency histograms to %s"), *path);
+	}
+	else {
+		UE_LOG(LogTemp, Warning, TEXT("Couldn't save latency histograms to %s"), *path);
+	}
+}
 
-		//update the rotated position. As anti-clockwise rotation, increment downwards
-		rotationPos--;
+void ATetrisBlock::Undo() {
+	//the last snapshot is from when the falling tetromino spawned, so the one before it is from before the last placement
+	if (playingReplay || game.IsGameOver() || undoHistory.Num() < 2) {
+		return;
+	}
 
-		//but reset to 3 if it drops below 0
-		if (rotationPos < 0) {
-			rotationPos = 3;
-		}
+	//the replay can't follow the game back in time, so a game that has been undone isn't saved
+	replayWriter.Discard();
 
-		//check for a t spin if a T tetromino
-		if (bTBlock) {
-			CheckForTSpin();
-		}
+	undoHistory.Pop(false);
+	game.RestoreState(undoHistory.Last());
 
-		//set bool to true in case of T spin/mini T spin
-		recentlyRotated = true;
-	}
+	//the player may not still be holding the controls they were when the snapshot was taken
+	game.SetHorizontalInput(heldDirection);
+	game.SetSoftDrop(false);
+	HandleGameEvents();
 }
 
-void ATetrisBlock::WallKick(TArray<FVector>& newPositions, FVector wallKickOffsets[4]) {
-	TArray<FVector> tempNewPositions;
-	bool validPosition = true;
-	FVector tempOrigin; 
-	//for each new position of the tetromino blocks
-	for (int i = 0; i < 4; ++i) {
-		tempOrigin = tetriminoOrigin;
-		validPosition = true;
-		tempNewPositions.Empty();
+void ATetrisBlock::RunAI() {
+	//start thinking about each new tetromino as soon as the last search has finished, throwing away a result meant for the last tetromino
+	if (!aiSearchStarted && !ai->IsSearching()) {
+		ai->TakeDecision(aiDecision);
+		aiSearchStarted = ai->StartSearch(game);
+	}
 
-		//get the origin of the tetromino when moved to new offset
-		tempOrigin += wallKickOffsets[i];
+	if (ai->TakeDecision(aiDecision)) {
+		aiDriver->Start(aiDecision);
+	}
 
-		for (int j = 0; j < newPositions.Num(); ++j) {
-			//calculate new position of the tetromino block based on the wall kick
-			FVector tempNewPos = newPositions[j] + wallKickOffsets[i];
+	//press the inputs a player would to move the tetromino along the AI's path
+	TetrisCore::AIControls controls;
+	aiDriver->Update(game, controls);
 
-			//but if position is same as a landed block or outside the playfield then set valid position to false
-			if (landedBlockPos.Contains(tempNewPos) || tempNewPos.Y < leftBoundary || tempNewPos.Y > rightBoundary || tempNewPos.Z < groundLevel) {
-				validPosition = false;
-			}
-			tempNewPositions.Add(tempNewPos);
-		}
+	//tap rather than hold, so each move happens straight away instead of waiting for auto shift
+	if (controls.horizontal != 0) {
+		MoveHorizontally((float)controls.horizontal);
+		MoveHorizontally(0.f);
+	}
 
-		//if all positions are valid
-		if (validPosition) {
-			//if final offset was used, then it was a large wall kick, making player eligable for T spin
-			if(i == 3 && bTBlock){
-				largeOffset = true;
-			}
-			//break the loop as can wall kick
-			break;
+	if (controls.softDrop != game.IsSoftDropping()) {
+		if (controls.softDrop) {
+			SpeedUpDrop();
+		}
+		else {
+			SlowDownDrop();
 		}
 	}
 
-	//if new tetromino position is valid
-	if (validPosition) {
-		//set new rotated positions for each tetromino block and the new origin
-		newPositions = tempNewPositions;
-		tetriminoOrigin = tempOrigin;
+	if (controls.rotate > 0) {
+		RotateClockwise();
 	}
-	else {
-		//otherwise, no wall kick was possible, so block the rotation
-		canRotate = false;
+	else if (controls.rotate < 0) {
+		RotateAntiClockwise();
 	}
-}
 
-void ATetrisBlock::RotateClockwise() {
-	//if game over then disable rotation by returning
-	if (blueprintFunctionality->bGameOver) {
-		return;
+	if (controls.hardDrop) {
+		HardDrop();
 	}
+}
 
-	//set comparison points high/low to make it easy to change
-	float lowestYPoint = 1e+10;
-	float highestYPoint = -1e+10;
-	float lowestZpoint = 1e+10;
-	TArray<FVector> newPositions;
-	bool shouldWallKick = false;
-	tSpin = false;
-	miniTSpin = false;
-	//calculate origin based on offset
-	tetriminoOrigin = spawnedBlocks[0]->GetActorLocation() + tetriminoOriginOffset;
-	for (int i = 0; i < 4; ++i) {
-		//code adapted from McGuire (2017)
-		//get offset from rotation origin of each block
-		FVector originOffset = spawnedBlocks[i]->GetActorLocation() - tetriminoOrigin;
-		//get position that block will rotate to, relative to x axis
-		FVector rotatedPos = originOffset.RotateAngleAxis(-90.f, FVector(1.f, 0.f, 0.f));
-		//get final position of block, relative to the rotation origin of the tetrimino
-		FVector newPosition = rotatedPos + tetriminoOrigin;
-
-		//round to nearest int as rotated position can sometimes be incorrect by ~ 0.1, creating collision bugs
-		FMath::RoundToInt(newPosition.Y);
-		FMath::RoundToInt(newPosition.Z);
-
-		//if new position of tetromino would result in clipping through wall or landed blocks then allow wall kick
-		if (landedBlockPos.Contains(newPosition) || newPosition.Y < leftBoundary || newPosition.Y > rightBoundary || newPosition.Z < groundLevel) {
-			shouldWallKick = true;
+void ATetrisBlock::SpawnTetromino() {
+	//the randomizer decides the tetromino, then its type picks the colour (see TetrisCore::PieceType)
+	game.SpawnNext();
+	int pieceType = (int)game.GetPiece().type;
+	UMaterial* blockColour = blockColours.IsValidIndex(pieceType) ? blockColours[pieceType] : nullptr;
+
+	//the queue has moved along by 1
+	UpdateNextQueue();
+
+	//remember the game as the tetromino spawned so it can be taken back, dropping the oldest snapshot once there are enough
+	if (practiceUndo && !game.IsGameOver()) {
+		if (undoHistory.Num() > FMath::Max(1, maxUndos)) {
+			undoHistory.RemoveAt(0, 1, false);
 		}
 
-		//update the new rotated positions
-		newPositions.Add(newPosition);
+		game.SaveState(undoHistory.AddDefaulted_GetRef());
 	}
 
-	//if wall kicking is enabled
-	if (shouldWallKick) {
-		//wall kick the tetromino based on its current rotation position and whether it is an I block
-		//see anti-clockwise offsets for more details
-		switch (rotationPos) {
-		case 0:
-			if (isIBlock) {
-				WallKick(newPositions, iClockwise0WallKickOffsets);
-				break;
-			}
+	//the AI needs to search again for the new tetromino
+	aiSearchStarted = false;
+	if (aiDriver.IsValid()) {
+		aiDriver->Stop();
+	}
 
-			WallKick(newPositions, clockwise0WallKickOffsets);
-			break;
-		case 1:
-			if (isIBlock) {
-				WallKick(newPositions, iClockwiseRWallKickOffsets);
-				break;
-			}
+	//the new tetromino overlapped the stack, so the game is over
+	if (game.IsGameOver()) {
+		blueprintFunctionality->GameOver();
+		SaveReplay();
+	}
 
-			WallKick(newPositions, clockwiseRWallKickOffsets);
-			break;
-		case 2:
-			if (isIBlock) {
-				WallKick(newPositions, iClockwise2WallKickOffsets);
-				break;
-			}
+	//spawn 4 blocks at the cells of the new tetromino based on the randomised colour
+	TetrisCore::Cell cells[4];
+	game.GetPieceCells(cells);
+	for (int i = 0; i < 4; ++i) {
+		SpawnBlock(CellToWorld(FIntPoint(cells[i].x, cells[i].y)), blockColour, i);
+	}
+}
 
-			WallKick(newPositions, clockwise2WallKickOffsets);
-			break;
-		case 3:
-			if (isIBlock) {
-				WallKick(newPositions, iClockwiseLWallKickOffsets);
-				break;
-			}
+void ATetrisBlock::SpawnBlock(FVector position, UMaterial* blockColour, int blockIndex) {
+	//takes a block from the pool and adds it to current blocks array based on the current index
+	spawnedBlocks[blockIndex] = AcquireBlock();
 
-			WallKick(newPositions, clockwiseLWallKickOffsets);
-			break;
-		default:
-			break;
-		}
+	//set position and colour based on parameters passed through
+	spawnedBlocks[blockIndex]->SetActorLocation(position);
+	spawnedBlocks[blockIndex]->SetColour(blockColour);
+}
+
+void ATetrisBlock::FillBlockPool() {
+	poolHits = 0;
+	poolMisses = 0;
+	poolHighWater = 0;
+	blocksInUse = 0;
+
+	blockPool.Reserve(initialPoolSize);
+	for (int i = 0; i < initialPoolSize; ++i) {
+		ASpawnedBlock* block = (ASpawnedBlock*)GWorld->SpawnActor(ASpawnedBlock::StaticClass());
+		block->SetActive(false);
+		blockPool.Add(block);
 	}
+}
 
-	//if rotating is enabled
-	if (canRotate) {
-		//update the new leftmost, rightmost and lowest positions of the tetromino
-		for (int i = 0; i < 4; ++i) {
-			if (newPositions[i].Y < lowestYPoint) {
-				lowestYPoint = newPositions[i].Y;
-				leftmostBlockIndex = i;
-			}
-			if (newPositions[i].Y > highestYPoint) {
-				highestYPoint = newPositions[i].Y;
-				rightmostBlockIndex = i;
-			}
-			if (newPositions[i].Z < lowestZpoint) {
-				lowestZpoint = newPositions[i].Z;
-				lowestBlockIndex = i;
-			}
-			//set the new location of the block
-			spawnedBlocks[i]->SetActorLocation(newPositions[i]);
-			//end of adapted code
-		}
+ASpawnedBlock* ATetrisBlock::AcquireBlock() {
+	ASpawnedBlock* block;
+
+	//reuse a pooled block if there is one, otherwise the pool has run dry so spawn a new block
+	if (blockPool.Num() > 0) {
+		block = blockPool.Pop(false);
+		poolHits++;
+	}
+	else {
+		block = (ASpawnedBlock*)GWorld->SpawnActor(ASpawnedBlock::StaticClass());
+		poolMisses++;
 	}
 
-	//update the origin offset based on the new position of the 1st block
-	tetriminoOriginOffset = tetriminoOrigin - spawnedBlocks[0]->GetActorLocation();
+	block->SetActive(true);
+
+	//track the most blocks that have been in use at once, to help size the pool
+	blocksInUse++;
+	poolHighWater = FMath::Max(poolHighWater, blocksInUse);
+
+	return block;
+}
 
-	//increment rotation position, increase as rotation is clockwise
-	rotationPos++;
+void ATetrisBlock::ReleaseBlock(ASpawnedBlock* block) {
+	//hide the block and put it back in the pool rather than destroying it
+	block->SetActive(false);
+	blockPool.Add(block);
+	blocksInUse--;
+}
 
-	//if position becomes greater than 3, reset to 0
-	if (rotationPos > 3) {
-		rotationPos = 0;
+void ATetrisBlock::CreateGhostBlocks() {
+	for (int i = 0; i < 4; ++i) {
+		ghostBlocks[i] = AcquireBlock();
+		ghostBlocks[i]->SetColour(ghostColour);
+
+		//the ghost is only a hint, so it shouldn't collide with anything
+		ghostBlocks[i]->SetActorEnableCollision(false);
 	}
+}
+
+void ATetrisBlock::UpdateGhostBlocks() {
+	TetrisCore::Cell cells[4];
+	game.GetGhostCells(cells);
 
-	//check to see if a T spin/mini T spin was performed
-	if (bTBlock) {
-		CheckForTSpin();
+	for (int i = 0; i < 4; ++i) {
+		ghostBlocks[i]->MoveBlock(CellToWorld(FIntPoint(cells[i].x, cells[i].y)));
 	}
+}
 
-	//set last move as a rotation
-	recentlyRotated = true;
+void ATetrisBlock::CreateStackMeshes() {
+	for (int i = 0; i < blockColours.Num(); ++i) {
+		UInstancedStaticMeshComponent* stackMesh = NewObject<UInstancedStaticMeshComponent>(this);
+		stackMesh->SetStaticMesh(blockMesh);
+		stackMesh->SetMaterial(0, blockColours[i]);
+		stackMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		stackMesh->RegisterComponent();
+		stackMeshes.Add(stackMesh);
+	}
 }
 
-void ATetrisBlock::CheckForTSpin() {
-	FVector positionsToCheck[4];
-	//get the positions diagonally above and below the T tetromino origin (i.e., block 1 position)
-	positionsToCheck[0] = spawnedBlocks[0]->GetActorLocation() + FVector(0.f, -100.f, 100.f);
-	positionsToCheck[1] = spawnedBlocks[0]->GetActorLocation() + FVector(0.f, 100.f, 100.f);
-	positionsToCheck[2] = spawnedBlocks[0]->GetActorLocation() + FVector(0.f, 100.f, -100.f);
-	positionsToCheck[3] = spawnedBlocks[0]->GetActorLocation() + FVector(0.f, -100.f, -100.f);
-
-	//based on the current rotation position of the tetromino (0 = 0, 1 = R, 2 = 2, 3= L)
-	switch (rotationPos) {
-	case 0:
-		//if rotation is 0, tetrominoes above are position 0 and 1 while below are position 2 and 3
-		if ((landedBlockPos.Contains(positionsToCheck[0]) && landedBlockPos.Contains(positionsToCheck[1])) && (landedBlockPos.Contains(positionsToCheck[2]) || landedBlockPos.Contains(positionsToCheck[3]))) {
-			//if 2 blocks are diagonally above and 1 is diagonally behind the origin, it is a T spin
-			tSpin = true;
-			return;
-		}
-		else if ((landedBlockPos.Contains(positionsToCheck[2]) && landedBlockPos.Contains(positionsToCheck[3])) && (landedBlockPos.Contains(positionsToCheck[0]) || landedBlockPos.Contains(positionsToCheck[1]))) {
-			//if 2 blocks are diagonally behind while 1 is above
-			//if it wall kicked by a large offset, it is still a T spin
-			if (largeOffset) {
-				tSpin = true;
-				return;
+void ATetrisBlock::RebuildStackMeshes() {
+	for (int colour = 0; colour < stackMeshes.Num(); ++colour) {
+		//gather the transform of every landed block of this colour, reusing the array so it doesn't reallocate
+		stackTransforms.Reset();
+		for (int row = 0; row < TetrisCore::Board::MaxRows; ++row) {
+			uint16 rowMask = game.GetBoard().GetRow(row);
+			for (int column = 0; rowMask != 0; ++column, rowMask >>= 1) {
+				if ((rowMask & 1) && game.GetBoard().GetCellPiece(column, row) == colour) {
+					stackTransforms.Add(FTransform(CellToWorld(FIntPoint(column, row))));
+				}
 			}
-			//but otherwise, it is a mini T spin
-			miniTSpin = true;
-			return;
 		}
 
-		break;
-	case 1:
-		//if rotation position is R, then positions 1 and 2 are in front of the tetromino and vice versa
-		if ((landedBlockPos.Contains(positionsToCheck[1]) && landedBlockPos.Contains(positionsToCheck[2])) && (landedBlockPos.Contains(positionsToCheck[0]) || landedBlockPos.Contains(positionsToCheck[3]))) {
-			//if 2 blocks in front and 1 behind, it is a T spin
-			tSpin = true;
-			return;
+		UInstancedStaticMeshComponent* stackMesh = stackMeshes[colour];
+		int existingInstances = stackMesh->GetInstanceCount();
+
+		//line clears only ever remove blocks, so drop the extra instances from the end (cheapest to remove)
+		for (int i = existingInstances - 1; i >= stackTransforms.Num(); --i) {
+			stackMesh->RemoveInstance(i);
 		}
-		else if ((landedBlockPos.Contains(positionsToCheck[0]) && landedBlockPos.Contains(positionsToCheck[3])) && (landedBlockPos.Contains(positionsToCheck[1]) || landedBlockPos.Contains(positionsToCheck[2]))) {
-			//if 2 blocks behind and 1 in front but tetromino was wall kicked by a large offset, it is still a T spin
-			if (largeOffset) {
-				tSpin = true;
-				return;
-			}
-			//otherwise, it is a mini T spin
-			miniTSpin = true;
-			return;
+
+		//add instances if this colour somehow has more blocks than before
+		for (int i = existingInstances; i < stackTransforms.Num(); ++i) {
+			stackMesh->AddInstance(stackTransforms[i]);
 		}
 
-		break;
-	case 2:
-		//if rotation position is 2, then positions 2 and 3 are in front and vice versa
-		if ((landedBlockPos.Contains(positionsToCheck[2]) && landedBlockPos.Contains(positionsToCheck[3])) && (landedBlockPos.Contains(positionsToCheck[0]) || landedBlockPos.Contains(positionsToCheck[1]))) {
-			//if 2 blocks are in front and at least 1 is behind, it is a T spin
-			tSpin = true;
-			return;
+		//then move all instances in a single batch
+		if (stackTransforms.Num() > 0) {
+			stackMesh->BatchUpdateInstancesTransforms(0, stackTransforms, true, true);
 		}
-		else if ((landedBlockPos.Contains(positionsToCheck[0]) && landedBlockPos.Contains(positionsToCheck[1])) && (landedBlockPos.Contains(positionsToCheck[2]) || landedBlockPos.Contains(positionsToCheck[3]))) {
-			//else if 2 blocks are behind and 1 is in front
-			//if it wall kicked by a large offset, it is a T spin
-			if (largeOffset) {
-				tSpin = true;
-				return;
-			}
-			//otherwise, it is a mini T spin
-			miniTSpin = true;
-			return;
+	}
+}
+
+void ATetrisBlock::SpeedUpDrop() {
+	//increase gravity to soft drop speed (i.e., very fast drop) so score is increased
+	ApplyInput(TetrisCore::InputType::SoftDrop, 1);
+}
+
+void ATetrisBlock::SlowDownDrop() {
+	//reset drop speed to current speed based on level
+	ApplyInput(TetrisCore::InputType::SoftDrop, 0);
+}
+
+void ATetrisBlock::HardDrop() {
+	//drop and lock the tetromino, then spawn a new tetromino
+	ApplyInput(TetrisCore::InputType::HardDrop, 0);
+}
+
+void ATetrisBlock::Rotate(int direction) {
+	ApplyInput(TetrisCore::InputType::Rotate, direction);
+}
+
+void ATetrisBlock::RotateAntiClockwise() {
+	Rotate(-1);
+}
+
+void ATetrisBlock::RotateClockwise() {
+	Rotate(1);
+}
+
+void ATetrisBlock::HandleGameEvents() {
+	uint32 events = game.TakeEvents();
+
+	//the whole game was replaced by a snapshot, so redraw everything rather than following the other events
+	if (events & TetrisCore::EventStateRestored) {
+		RebuildStackMeshes();
+		UpdateNextQueue();
+
+		int pieceType = (int)game.GetPiece().type;
+		for (int i = 0; i < 4; ++i) {
+			spawnedBlocks[i]->SetColour(blockColours.IsValidIndex(pieceType) ? blockColours[pieceType] : nullptr);
+		}
+
+		UpdateFallingBlocks();
+		UpdateGhostBlocks();
+		scoreTextDirty = true;
+		UpdateLevel();
+		return;
+	}
+
+	if (events & TetrisCore::EventPieceLocked) {
+		//the tetromino is now part of the stack, so return its blocks to the pool
+		for (int i = 0; i < 4; ++i) {
+			ReleaseBlock(spawnedBlocks[i]);
 		}
 
-		break;
-	case 3:
-		//if rotation position is 3, then positions 0 and 3 are in front and vice versa
-		if ((landedBlockPos.Contains(positionsToCheck[0]) && landedBlockPos.Contains(positionsToCheck[3])) && (landedBlockPos.Contains(positionsToCheck[1]) || landedBlockPos.Contains(positionsToCheck[2]))) {
-			//if 2 blocks are in front and at least 1 is behind, it is a T spin
-			tSpin = true;
-			return;
+		//redraw the whole stack if lines were cleared, otherwise just draw the landed blocks as part of the stack
+		const TetrisCore::LockResult& lock = game.GetLastLock();
+		if (events & TetrisCore::EventLinesCleared) {
+			RebuildStackMeshes();
 		}
-		else if ((landedBlockPos.Contains(positionsToCheck[1]) && landedBlockPos.Contains(positionsToCheck[2])) && (landedBlockPos.Contains(positionsToCheck[0]) || landedBlockPos.Contains(positionsToCheck[3]))) {
-			//else if 2 blocks are in behind and 1 is in front
-			//if it wall kicked by a large offset, it is a T spin
-			if (largeOffset) {
-				tSpin = true;
-				return;
+		else if (stackMeshes.IsValidIndex((int)lock.type)) {
+			for (int i = 0; i < 4; ++i) {
+				stackMeshes[(int)lock.type]->AddInstance(FTransform(CellToWorld(FIntPoint(lock.cells[i].x, lock.cells[i].y))));
 			}
-			//otherwise, it is a mini T spin
-			miniTSpin = true;
-			return;
 		}
+	}
+
+	//soft drop changes the score every row, so the text is only rebuilt once at the end of the frame
+	if (events & TetrisCore::EventScoreChanged) {
+		scoreTextDirty = true;
+	}
+
+	if (events & TetrisCore::EventLevelChanged) {
+		UpdateLevel();
+	}
+
+	if (events & TetrisCore::EventGameOver) {
+		blueprintFunctionality->GameOver();
+		SaveReplay();
+		return;
+	}
+
+	if (game.NeedsSpawn()) {
+		SpawnTetromino();
+
+		//spawning moves the ghost to the new tetromino
+		events |= game.TakeEvents();
+	}
+	else if (events & TetrisCore::EventPieceMoved) {
+		UpdateFallingBlocks();
+	}
+
+	//the ghost only moves when the tetromino moves sideways, rotates or a new one spawns, not every frame
+	if ((events & TetrisCore::EventGhostMoved) && !game.IsGameOver()) {
+		UpdateGhostBlocks();
+	}
+}
+
+void ATetrisBlock::UpdateFallingBlocks() {
+	TetrisCore::Cell cells[4];
+	game.GetPieceCells(cells);
 
-		break;
-	default:
-		break;
+	for (int i = 0; i < 4; ++i) {
+		spawnedBlocks[i]->MoveBlock(CellToWorld(FIntPoint(cells[i].x, cells[i].y)));
 	}
 }
 
-void ATetrisBlock::UpdateScore(int scoreIncrease) {
-	//increase score by scoreIncrease parameter
-	score += scoreIncrease;
+void ATetrisBlock::UpdateScore() {
+	scoreTextDirty = false;
 
 	//update the score text
-	ScoreText->SetText(FText::FromString("Score = " + FString::FromInt(score)));
+	ScoreText->SetText(FText::FromString("Score = " + FString::FromInt(game.GetScore())));
+
+	//and tell the UI
+	if (blueprintFunctionality) {
+		blueprintFunctionality->ScoreChanged(game.GetScore());
+	}
 }
 
 void ATetrisBlock::UpdateLevel() {
-	//increment level
-	level++;
-
 	//update level text
-	LevelText->SetText(FText::FromString("Level = " + FString::FromInt(level)));
+	LevelText->SetText(FText::FromString("Level = " + FString::FromInt(game.GetLevel())));
+
+	//and tell the UI
+	if (blueprintFunctionality) {
+		blueprintFunctionality->LevelChanged(game.GetLevel());
+	}
 }
 
 void ATetrisBlock::GetBlueprintFunctionality() {
@@ -1110,4 +932,29 @@ void ATetrisBlock::GetBlueprintFunctionality() {
 			break;
 		}
 	}
-}
\ No newline at end of file
+}
+
+FIntPoint ATetrisBlock::WorldToCell(const FVector& location) const {
+	//columns are counted from the left boundary and rows from the ground, each cell being 1 tetris unit (100 Unreal units)
+	return FIntPoint(FMath::RoundToInt((location.Y - leftBoundary) / 100.f), FMath::RoundToInt((location.Z - groundLevel) / 100.f));
+}
+
+TArray<FVector> ATetrisBlock::GetLandedBlockPositions() const {
+	TArray<FVector> positions;
+
+	//convert every set bit of the playfield back into a world location
+	for (int row = 0; row < TetrisCore::Board::MaxRows; ++row) {
+		uint16 rowMask = game.GetBoard().GetRow(row);
+		for (int column = 0; rowMask != 0; ++column, rowMask >>= 1) {
+			if (rowMask & 1) {
+				positions.Add(CellToWorld(FIntPoint(column, row)));
+			}
+		}
+	}
+
+	return positions;
+}
+
+FVector ATetrisBlock::CellToWorld(FIntPoint cell) const {
+	return FVector(xSpawnPoint, leftBoundary + cell.X * 100.f, groundLevel + cell.Y * 100.f);
+}
@@ -4,6 +4,11 @@
 
 #include "Engine.h"
 #include "GameFramework/Pawn.h"
+#include "TetrisCore/TetrisAI.h"
+#include "TetrisCore/TetrisGame.h"
+#include "TetrisCore/TetrisLatency.h"
+#include "TetrisCore/TetrisReplay.h"
+#include "TetrisCore/TetrisSimulation.h"
 #include "TetrisBlock.generated.h"
 
 class ASpawnedBlock;
@@ -23,30 +28,90 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Called when the game ends or the actor is removed
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
-	//controls the landing behaviour of the tetris blocks
-	void RegisterAndCheckBlocks();
-
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
 	//controls horizontal movement by player
 	void MoveHorizontally(float axisValue);
 
+	//holds left, taking over from right if it is held too
+	void PressLeft();
+
+	//lets go of left
+	void ReleaseLeft();
+
+	//holds right, taking over from left if it is held too
+	void PressRight();
+
+	//lets go of right
+	void ReleaseRight();
+
+	//records a player input for the replay, then passes it to the game
+	void ApplyInput(TetrisCore::InputType type, int value);
+
+	//loads the replay file and starts playing it back instead of a live game. Returns false if it couldn't be loaded
+	bool StartReplay(const TetrisCore::GameConfig& config);
+
+	//plays the replay on by DeltaTime seconds, or to the end if playing at max speed
+	void AdvanceReplay(float DeltaTime);
+
+	//updates the scene and UI to match the game after any amount of play, from a replay or the simulation thread, in one go
+	void ShowLatestState();
+
+	//starts the game on the simulation thread, leaving this game to mirror it
+	void StartSimulation(const TetrisCore::GameConfig& config);
+
+	//copies the newest frame from the simulation thread into the mirror and shows it. Returns false if there was no new frame
+	bool PresentSimulation();
+
+	//finishes the recording of this game and saves it to Saved/Replays
+	void SaveReplay();
+
+	//takes back the last tetromino placed, putting the game back to when it spawned (practice mode only)
+	void Undo();
+
+	//notes that the results of every input shown so far are being submitted for rendering, and updates the latency HUD when it is due
+	void PresentLatency(float DeltaTime);
+
+	//passes the latency percentiles of every input to the UI
+	void ReportLatency();
+
+	//writes the latency percentiles to the log and the full histograms to Saved/Latency
+	void SaveLatencyReport();
+
+	//lets the AI think about the falling tetromino in the background, then presses the same inputs as a player to place it
+	void RunAI();
+
 	//spawns a singular block based on parameters passed through
 	void SpawnBlock(FVector position, UMaterial* blockColour, int blockIndex);
 
-	//checks row of current block to see if line has been cleared
-	void CheckRow(ASpawnedBlock* currentBlock);
+	//spawns initialPoolSize hidden blocks for the block pool
+	void FillBlockPool();
+
+	//takes a block from the pool, spawning a new one if the pool is empty
+	ASpawnedBlock* AcquireBlock();
+
+	//hides a block and returns it to the pool
+	void ReleaseBlock(ASpawnedBlock* block);
+
+	//takes 4 blocks from the pool to show the ghost tetromino for the rest of the game
+	void CreateGhostBlocks();
+
+	//moves the ghost blocks to where the falling tetromino would land
+	void UpdateGhostBlocks();
 
-	//deletes all blocks in blocks array from the game
-	void RemoveBlocks(TArray<ASpawnedBlock*> blocks);
+	//creates an instanced mesh for each block colour, used to draw all landed blocks
+	void CreateStackMeshes();
 
-	//moves all blocks in blocks array down by 100 units (equivalent of 1 tetris unit)
-	void ShiftBlocksDown(TArray<ASpawnedBlock*> blocks);
+	//updates the instances of every stack mesh to match the playfield
+	void RebuildStackMeshes();
 
 	//controls soft drop behaviours
 	void SpeedUpDrop();
@@ -57,35 +122,44 @@ public:
 	//spawns the entire tetromino
 	void SpawnTetromino();
 
+	//rotates the tetromino clockwise (direction = 1) or anti clockwise (direction = -1)
+	void Rotate(int direction);
+
 	//rotates the tetromino anti clockwise
 	void RotateAntiClockwise();
 
 	//rotates the tetromino clockwise
 	void RotateClockwise();
 
-	//wall kicks tetromino if rotation was illegal
-	void WallKick(TArray<FVector>& newPositions, FVector wallKickOffsets[4]);
+	//controls behaviour of a locking hard drop
+	void HardDrop();
 
-	//updates players score. Default of 100
-	void UpdateScore(int scoreIncrease = 100);
+	//updates the scene and UI to match everything that happened in the game since the last call
+	void HandleGameEvents();
 
-	//increases the level by 1
-	void UpdateLevel();
+	//moves the blocks of the falling tetromino to match the game
+	void UpdateFallingBlocks();
 
-	//controls behaviour of a locking hard drop
-	void HardDrop();
+	//updates the score text to the current score
+	void UpdateScore();
 
-	//checks if player performed a t-spin after rotation
-	void CheckForTSpin();
+	//updates the level text to the current level
+	void UpdateLevel();
 
 	//gets the blueprint functionality class in the game world
 	void GetBlueprintFunctionality();
 
-	//get the next tetromino colour due to spawn
-	void GetNextColourIndex();
+	//passes the next 3 tetrominoes due to spawn to the UI
+	void UpdateNextQueue();
+
+	//converts a world location into the column and row of the playfield it is in
+	FIntPoint WorldToCell(const FVector& location) const;
 
-	//get position of lowest point of tetromino
-	float GetLowestZPosition();
+	//converts a column and row of the playfield into the world location of its center
+	FVector CellToWorld(FIntPoint cell) const;
+
+	//gets the world location of all landed blocks, derived from the playfield bitboard
+	TArray<FVector> GetLandedBlockPositions() const;
 
 	//current score text component
 	UPROPERTY(Category = Grid, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
@@ -99,10 +173,6 @@ public:
 	UPROPERTY(EditAnywhere)
 	float groundLevel;
 
-	//distance that tetromino drops periodically (i.e., distance of 1 tetris unit)
-	UPROPERTY(EditAnywhere)
-	float dropDist;
-
 	//furthest Y point to the left
 	UPROPERTY(EditAnywhere)
 	float leftBoundary;
@@ -123,175 +193,187 @@ public:
 	UPROPERTY(EditAnywhere)
 	TArray<UMaterial*> blockColours;
 
-	//maximum Z value of a tetromino, beyond this will trigger game over
+	//seed of the tetromino randomizer. The same seed always spawns the same tetrominoes, 0 = new seed every game
 	UPROPERTY(EditAnywhere)
-	float overflowHeight;
+	int seed;
 
-	//reference to the in game camera
+	//translucent material of the ghost tetromino, showing where the falling tetromino will land
 	UPROPERTY(EditAnywhere)
-	USceneComponent* camera;
+	UMaterial* ghostColour;
 
-	//wall kick offsets tested when rotated clockwise from position 0 (the starting rotation) excluding I block
+	//maximum Z value of a tetromino, beyond this will trigger game over
 	UPROPERTY(EditAnywhere)
-	FVector clockwise0WallKickOffsets[4];
+	float overflowHeight;
 
-	//wall kick offsets tested when rotated clockwise from position R (rotation when rotated clockwise from start rotation) excluding I block
-	UPROPERTY(EditAnywhere)
-	FVector clockwiseRWallKickOffsets[4];
+	//if true, every game is recorded to a replay file in Saved/Replays when it ends
+	UPROPERTY(EditAnywhere, Category = "Replay")
+	bool recordReplay;
 
-	//wall kick offsets tested when rotated clockwise from position 2 (rotation when rotated twice in same direction from start rotation) excluding I block
-	UPROPERTY(EditAnywhere)
-	FVector clockwise2WallKickOffsets[4];
+	//replay file in Saved/Replays to play back instead of a live game. Leave empty to play normally
+	UPROPERTY(EditAnywhere, Category = "Replay")
+	FString replayFile;
 
-	//wall kick offsets tested when rotated clockwise from position L (rotation when rotated anticlockwise from start rotation) excluding I block
-	UPROPERTY(EditAnywhere)
-	FVector clockwiseLWallKickOffsets[4];
+	//if true, the whole replay is played in a single frame as fast as possible (e.g., for profiling), otherwise it plays in real time
+	UPROPERTY(EditAnywhere, Category = "Replay")
+	bool playbackAtMaxSpeed;
 
-	//wall kick offsets tested when rotated anti-clockwise from position 0 excluding I block
-	UPROPERTY(EditAnywhere)
-	FVector antiClockwise0WallKickOffsets[4];
+	//if true, the built in AI plays instead of the player, using the same inputs (e.g., for soak tests and demo mode)
+	UPROPERTY(EditAnywhere, Category = "AI")
+	bool aiPlayer;
 
-	//wall kick offsets tested when rotated anti-clockwise from position L excluding I block
-	UPROPERTY(EditAnywhere)
-	FVector antiClockwiseLWallKickOffsets[4];
+	//seconds the AI may spend searching for each move. It searches on its own threads, so this never stalls the game
+	UPROPERTY(EditAnywhere, Category = "AI")
+	float aiTimeBudget;
 
-	//wall kick offsets tested when rotated anti-clockwise from position 2 excluding I block
-	UPROPERTY(EditAnywhere)
-	FVector antiClockwise2WallKickOffsets[4];
+	//boards the AI keeps at each step of its lookahead. Wider is stronger but slower
+	UPROPERTY(EditAnywhere, Category = "AI")
+	int aiBeamWidth;
 
-	//wall kick offsets tested when rotated anti-clockwise from position R excluding I block
-	UPROPERTY(EditAnywhere)
-	FVector antiClockwiseRWallKickOffsets[4];
+	//threads the AI searches on
+	UPROPERTY(EditAnywhere, Category = "AI")
+	int aiThreads;
 
-	//wall kick offsets tested when I block is rotated clockwise from position 0
-	UPROPERTY(EditAnywhere)
-	FVector iClockwise0WallKickOffsets[4];
+	//if true, the game runs on its own thread at simulationRate, so hitches on the game thread don't hold up gravity or lock delay
+	//practice undo rewinds the game from the game thread, so it always runs the game on the game thread
+	UPROPERTY(EditAnywhere, Category = "Simulation")
+	bool simulationThread;
 
-	//wall kick offsets tested when I block is rotated clockwise from position R
-	UPROPERTY(EditAnywhere)
-	FVector iClockwiseRWallKickOffsets[4];
+	//fixed steps per second the game is simulated at, on either thread. Replays are played back at the rate they were recorded at
+	UPROPERTY(EditAnywhere, Category = "Simulation")
+	int simulationRate;
 
-	//wall kick offsets tested when I block is rotated clockwise from position 2
-	UPROPERTY(EditAnywhere)
-	FVector iClockwise2WallKickOffsets[4];
+	//seconds left or right has to be held before the tetromino starts moving on its own. The first move always happens as soon as it is pressed
+	UPROPERTY(EditAnywhere, Category = "Controls")
+	float autoShiftDelay;
 
-	//wall kick offsets tested when I block is rotated clockwise from position L
-	UPROPERTY(EditAnywhere)
-	FVector iClockwiseLWallKickOffsets[4];
+	//seconds between each move once the tetromino is moving on its own, 0 = straight to the wall
+	UPROPERTY(EditAnywhere, Category = "Controls")
+	float autoRepeatRate;
 
-	//wall kick offsets tested when I block is rotated anti-clockwise from position 0
-	UPROPERTY(EditAnywhere)
-	FVector iAntiClockwise0WallKickOffsets[4];
+	//if true, the Undo input takes back the last tetromino placed. A game that has been undone isn't saved as a replay
+	UPROPERTY(EditAnywhere, Category = "Practice")
+	bool practiceUndo;
 
-	//wall kick offsets tested when I block is rotated anti-clockwise from position L
-	UPROPERTY(EditAnywhere)
-	FVector iAntiClockwiseLWallKickOffsets[4];
+	//most tetrominoes that can be taken back in a row
+	UPROPERTY(EditAnywhere, Category = "Practice")
+	int maxUndos;
 
-	//wall kick offsets tested when I block is rotated anti-clockwise from position 2
-	UPROPERTY(EditAnywhere)
-	FVector iAntiClockwise2WallKickOffsets[4];
+	//if true, the time from each input to the game applying it and to its result being submitted for rendering is measured
+	UPROPERTY(EditAnywhere, Category = "Latency")
+	bool measureLatency;
+
+	//seconds between each update of the latency HUD
+	UPROPERTY(EditAnywhere, Category = "Latency")
+	float latencyReportInterval;
+
+	//amount of blocks spawned into the block pool when the game starts. Only the falling and ghost tetrominoes use pooled blocks
+	UPROPERTY(EditAnywhere, Category = "Block Pool")
+	int initialPoolSize;
+
+	//amount of blocks taken from the pool without needing to spawn a new block
+	UPROPERTY(VisibleAnywhere, Category = "Block Pool")
+	int poolHits;
 
-	//wall kick offsets tested when I block is rotated anti-clockwise from position R
+	//amount of blocks that had to be spawned because the pool was empty
+	UPROPERTY(VisibleAnywhere, Category = "Block Pool")
+	int poolMisses;
+
+	//most blocks that have been in use at the same time
+	UPROPERTY(VisibleAnywhere, Category = "Block Pool")
+	int poolHighWater;
+
+	//reference to the in game camera
 	UPROPERTY(EditAnywhere)
-	FVector iAntiClockwiseRWallKickOffsets[4];
+	USceneComponent* camera;
 
 private:
-	//current velocity of tetromino
-	FVector CurrentVelocity;
+	//the game rules. This class only displays the game and passes input into it
+	TetrisCore::Game game;
 
 	//the position of each block in the current tetromino
 	ASpawnedBlock* spawnedBlocks[4];
 
-	//the position of all landed blocks which haven't been cleared
-	TArray<FVector> landedBlockPos;
+	//records the seed and inputs of the current game
+	TetrisCore::ReplayWriter replayWriter;
 
-	//reference to all blocks currently in the scene
-	TArray<ASpawnedBlock*> allBlocks;
+	//plays a replay file back into the game
+	TetrisCore::ReplayPlayer replayPlayer;
 
-	//possible tetromino colours that can spawn. Removed once selected but updated to full when array is empty
-	TArray<UMaterial*> colourPool;
+	//contents of the replay file being played. Kept loaded as the replay player reads from it
+	TArray<uint8> replayData;
 
-	//times when the tetromino last dropped 1 tetris unit
-	float dropTimer;
+	//seconds of replay played so far when playing in real time
+	float replayTime;
 
-	//times when the player last move the tetromino left or right
-	float inputTimer;
+	//true while a replay file is being played instead of a live game
+	bool playingReplay;
 
-	//the frequency that the tetromino should drop 1 tetris unit. Decreases in later levels
-	float dropSpeed;
+	//threads the AI searches on. Declared before the AI so it is destroyed after it
+	TUniquePtr<TetrisCore::ThreadPool> aiPool;
 
-	//current level that the player is at, affects the drop speed
-	int level;
+	//searches the falling tetromino and the next queue for the best placement
+	TUniquePtr<TetrisCore::LookaheadAI> ai;
 
-	//total amount of lines cleared currently
-	int linesCleared;
+	//turns the AI's chosen placement into inputs
+	TUniquePtr<TetrisCore::PlacementDriver> aiDriver;
 
-	//leftmost position of the tetromino
-	int leftmostBlockIndex;
+	//latest placement chosen by the AI
+	TetrisCore::AIDecision aiDecision;
 
-	//rightmost position of the tetromino
-	int rightmostBlockIndex;
+	//true once the AI has started searching for the current tetromino
+	bool aiSearchStarted;
 
-	//lowest position of the tetromino
-	int lowestBlockIndex;
+	//runs the game when simulationThread is set. The game above then only mirrors its latest frame, for the scene and the AI to read
+	TUniquePtr<TetrisCore::SimulationThread> simulation;
 
-	//current rotation position of tetromino (0 = 0 pos, 1 = R pos, 2 = 2 pos, 3 = L pos, see wall kick offsets for position meanings)
-	int rotationPos;
+	//latest frame taken from the simulation thread, kept so taking one doesn't need a 1.3KB stack copy each frame
+	TetrisCore::SimulationFrame simulationFrame;
 
-	//checks if tetromino is an I tetromino
-	bool isIBlock;
+	//amount of inputs sent to the simulation thread. The AI waits until the mirror has caught up with them before pressing anything else
+	uint64 simulationInputsSent;
 
-	//rotation origin of the tetromino
-	FVector tetriminoOrigin;
+	//direction last passed to the game, so the held direction is only sent when it changes
+	int heldDirection;
 
-	//offset from block 1 position if center is not block 1 position (i.e., for I and O blocks)
-	FVector tetriminoOriginOffset;
+	//true while the left/right inputs are held. The last one pressed wins while both are held
+	bool leftHeld;
+	bool rightHeld;
 
-	//reference to the main camera in the scene
-	UCameraComponent* mainCamera;
-
-	//current player's score
-	int score;
-
-	//if true, player can hard lock tetromino
-	bool canHardLock;
+	//follows each input through the game and keeps a latency histogram per input and stage
+	TetrisCore::LatencyTracker latency;
 
-	//if false once all wall kick offsets were tested, blocks a rotation
-	bool canRotate;
+	//seconds since the latency HUD was last updated
+	float latencyReportTime;
 
-	//index of current block that is compared to check its landing position when hard locked
-	int ZCompareIndex;
+	//snapshot of the game as each of the last few tetrominoes spawned, newest last. Only kept in practice mode
+	TArray<TetrisCore::GameState> undoHistory;
 
-	//amount of rows cleared from the landed tetromino, used for scoring
-	int rowsClearedInMove;
+	//blocks showing where the current tetromino will land. Taken from the pool once and moved for every tetromino
+	ASpawnedBlock* ghostBlocks[4];
 
-	//if true, will increase drop speed to soft drop speed
-	bool bSoftDrop;
+	//one instanced mesh per block colour, drawing every landed block in a single draw call per colour
+	UPROPERTY()
+	TArray<UInstancedStaticMeshComponent*> stackMeshes;
 
-	//reports if current tetromino is a T block
-	bool bTBlock;
+	//reused when rebuilding the stack meshes so the array doesn't reallocate after every line clear
+	TArray<FTransform> stackTransforms;
 
-	//reports if last move before locking tetromino was a rotation, if true, will check for a T spin
-	bool recentlyRotated;
+	//cube mesh used by the stack meshes
+	UPROPERTY()
+	UStaticMesh* blockMesh;
 
-	//if true, player has performed a T spin
-	bool tSpin;
+	//hidden blocks that are ready to be reused
+	TArray<ASpawnedBlock*> blockPool;
 
-	//if true, player has performed a mini T spin
-	bool miniTSpin;
+	//amount of blocks currently taken from the pool
+	int blocksInUse;
 
-	//if true, when rotated, T block has wall kicked to a large offset (i.e., offset 4 in wall kick array)
-	bool largeOffset;
+	//true when the score has changed since the score text was last updated
+	bool scoreTextDirty;
 
-	//checks if player performed a difficult move when block was landed (i.e., tetris, mini T Spin/T spin single, mini T spin/T spin double or T spin triple)
-	bool difficultMovePerformed;
-
-	//multiplies score earnt by multiplier. Used for back-to-back difficult moves
-	float scoreMultiplier;
+	//reference to the main camera in the scene
+	UCameraComponent* mainCamera;
 
 	//reference to the blueprint functionality class
 	ABlueprintFunctionality* blueprintFunctionality;
-
-	//colours of next 3 tetrominoes to spawn
-	TArray<UMaterial*> nextColours;
 };
@@ -0,0 +1,535 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TetrisAI.h"
+#include "TetrisBits.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace TetrisCore
+{
+	typedef std::chrono::steady_clock Clock;
+
+	namespace
+	{
+		bool SamePiece(const Piece& a, const Piece& b) {
+			return a.type == b.type && a.rotation == b.rotation && a.x == b.x && a.y == b.y;
+		}
+
+		//returns true if the tetrominoes cover the same cells, even if their rotations differ (e.g., the O block)
+		bool SameCells(const Piece& a, const Piece& b) {
+			Cell cellsA[4];
+			Cell cellsB[4];
+			a.GetCells(cellsA);
+			b.GetCells(cellsB);
+
+			for (int i = 0; i < 4; ++i) {
+				bool found = false;
+				for (int j = 0; j < 4 && !found; ++j) {
+					found = cellsA[i].x == cellsB[j].x && cellsA[i].y == cellsB[j].y;
+				}
+
+				if (!found) {
+					return false;
+				}
+			}
+
+			return true;
+		}
+	}
+
+	void AISearchRequest::Capture(const Game& game, int previewCount) {
+		board = game.GetBoard();
+		instantGravity = game.HasInstantGravity();
+
+		//with instant gravity the tetromino will be on the ground after the next step, so search from there
+		piece = instantGravity ? game.GetGhost() : game.GetPiece();
+
+		numPreview = std::min(std::max(previewCount, 0), PieceRandomizer::PreviewSize);
+		for (int i = 0; i < numPreview; ++i) {
+			preview[i] = game.GetRandomizer().Peek(i);
+		}
+
+		spawnColumn = game.GetConfig().spawnColumn;
+		spawnRow = game.GetConfig().spawnRow;
+		overflowRow = game.GetConfig().overflowRow;
+	}
+
+	LookaheadAI::LookaheadAI(ThreadPool* threadPool, const AIConfig& aiConfig)
+		: config(aiConfig), pool(threadPool), searching(false), decisionReady(false)
+	{
+		config.beamWidth = std::max(1, config.beamWidth);
+
+		//the calling thread plus every worker can take part in a ParallelFor
+		int numSlots = pool != nullptr ? pool->GetNumThreads() + 1 : 1;
+		for (int i = 0; i < numSlots; ++i) {
+			scratch.push_back(std::unique_ptr<Scratch>(new Scratch()));
+		}
+
+		if (config.transpositionTableBits > 0) {
+			table.reset(new TranspositionTable(config.transpositionTableBits));
+		}
+
+		//the beam and candidates are allocated once here rather than for every search
+		beam.resize((size_t)config.beamWidth);
+		nextBeam.resize((size_t)config.beamWidth);
+		candidates.resize((size_t)config.beamWidth * MoveGenerator::MaxPlacements);
+		candidateCounts.resize((size_t)config.beamWidth);
+		order.reserve(candidates.size());
+	}
+
+	LookaheadAI::~LookaheadAI()
+	{
+		std::unique_lock<std::mutex> lock(searchMutex);
+		searchDone.wait(lock, [this]() { return !searching; });
+	}
+
+	void LookaheadAI::Search(const AISearchRequest& request, AIDecision& decision) {
+		Clock::time_point startTime = Clock::now();
+		Clock::time_point deadline = startTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.timeBudget));
+		bool limited = config.timeBudget > 0.0;
+
+		decision.found = false;
+		decision.start = request.piece;
+		decision.pathLength = 0;
+		decision.depthSearched = 0;
+		decision.boardsEvaluated = 0;
+		TranspositionStats startStats = GetTableStats();
+
+		beam[0].board = request.board;
+		beam[0].rootPlacement = -1;
+		beam[0].linesCleared = 0;
+		int beamSize = 1;
+		int bestRoot = -1;
+
+		int maxDepth = 1 + std::min(config.previewDepth, request.numPreview);
+		for (int depth = 0; depth < maxDepth; ++depth) {
+			//the falling tetromino is always placed, deeper searches stop when out of time
+			if (depth > 0 && limited && Clock::now() > deadline) {
+				break;
+			}
+
+			std::atomic<bool> outOfTime(false);
+			if (depth == 0) {
+				ExpandNode(request, depth, 0, *scratch[0]);
+			}
+			else if (pool != nullptr) {
+				pool->ParallelFor(beamSize, [&](int index, int slot) {
+					if (limited && Clock::now() > deadline) {
+						outOfTime = true;
+						return;
+					}
+
+					ExpandNode(request, depth, index, *scratch[slot]);
+				});
+			}
+			else {
+				for (int index = 0; index < beamSize && !outOfTime; ++index) {
+					outOfTime = limited && Clock::now() > deadline;
+					if (!outOfTime) {
+						ExpandNode(request, depth, index, *scratch[0]);
+					}
+				}
+			}
+
+			//a depth that wasn't finished would favour the nodes that happened to be expanded, so use the last full depth
+			if (outOfTime) {
+				break;
+			}
+
+			order.clear();
+			for (int node = 0; node < beamSize; ++node) {
+				for (int i = 0; i < candidateCounts[node]; ++i) {
+					order.push_back(node * MoveGenerator::MaxPlacements + i);
+				}
+			}
+
+			if (order.empty()) {
+				break;
+			}
+
+			//best scores first. Ties go to the earliest candidate, so the result doesn't depend on which thread finished first
+			//twice the beam is sorted, as different placements often leave the same board and only the best of those is kept
+			int sorted = std::min(config.beamWidth * 2, (int)order.size());
+			std::partial_sort(order.begin(), order.begin() + sorted, order.end(), [this](int a, int b) {
+				return candidates[a].score != candidates[b].score ? candidates[a].score > candidates[b].score : a < b;
+			});
+
+			int keep = 0;
+			for (int i = 0; i < sorted && keep < config.beamWidth; ++i) {
+				const Candidate& candidate = candidates[order[i]];
+				const BeamNode& parent = beam[candidate.node];
+				BeamNode& child = nextBeam[keep];
+
+				child.board = parent.board;
+				child.linesCleared = parent.linesCleared + PlaceOnBoard(child.board, candidate.piece);
+				child.rootPlacement = depth == 0 ? candidate.placement : parent.rootPlacement;
+
+				//a board already in the beam would be searched twice for the same result
+				bool duplicate = false;
+				for (int j = 0; j < keep && !duplicate; ++j) {
+					duplicate = nextBeam[j].board.GetHash() == child.board.GetHash();
+				}
+
+				if (!duplicate) {
+					keep++;
+				}
+			}
+
+			std::swap(beam, nextBeam);
+			beamSize = keep;
+			bestRoot = beam[0].rootPlacement;
+			decision.depthSearched = depth + 1;
+			decision.boardsEvaluated += (int)order.size();
+		}
+
+		if (bestRoot >= 0) {
+			decision.found = true;
+			decision.target = rootGenerator.GetPlacement(bestRoot).piece;
+			decision.pathLength = std::min(rootGenerator.GetPath(bestRoot, decision.path, MaxAIPathLength, decision.pathStates), MaxAIPathLength);
+		}
+
+		TranspositionStats endStats = GetTableStats();
+		decision.tableProbes = endStats.probes - startStats.probes;
+		decision.tableHits = endStats.hits - startStats.hits;
+		decision.seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+	}
+
+	bool LookaheadAI::StartSearch(const Game& game) {
+		{
+			std::lock_guard<std::mutex> lock(searchMutex);
+			if (searching) {
+				return false;
+			}
+
+			pendingRequest.Capture(game, config.previewDepth);
+			searching = true;
+			decisionReady = false;
+		}
+
+		auto runSearch = [this]() {
+			Search(pendingRequest, pendingDecision);
+
+			std::lock_guard<std::mutex> lock(searchMutex);
+			searching = false;
+			decisionReady = true;
+			searchDone.notify_all();
+		};
+
+		if (pool != nullptr) {
+			pool->Submit(runSearch);
+		}
+		else {
+			runSearch();
+		}
+
+		return true;
+	}
+
+	bool LookaheadAI::TakeDecision(AIDecision& decision) {
+		std::lock_guard<std::mutex> lock(searchMutex);
+		if (!decisionReady) {
+			return false;
+		}
+
+		decision = pendingDecision;
+		decisionReady = false;
+		return true;
+	}
+
+	TranspositionStats LookaheadAI::GetTableStats() const {
+		if (table == nullptr) {
+			return TranspositionStats{ 0, 0, 0 };
+		}
+
+		return table->GetStats();
+	}
+
+	bool LookaheadAI::IsSearching() const {
+		std::lock_guard<std::mutex> lock(searchMutex);
+		return searching;
+	}
+
+	void LookaheadAI::ExpandNode(const AISearchRequest& request, int depth, int nodeIndex, Scratch& nodeScratch) {
+		const BeamNode& node = beam[nodeIndex];
+		candidateCounts[nodeIndex] = 0;
+
+		//the falling tetromino keeps its generator so the path to the chosen placement can be read at the end
+		MoveGenerator& generator = depth == 0 ? rootGenerator : nodeScratch.generator;
+		Piece start = request.piece;
+
+		if (depth > 0) {
+			start = Piece{ request.preview[depth - 1], 0, request.spawnColumn, request.spawnRow };
+
+			//spawning inside the stack is game over, so there is nothing to place
+			Cell spawnCells[4];
+			start.GetCells(spawnCells);
+			if (node.board.Collides(spawnCells)) {
+				return;
+			}
+
+			//everything above the stack is open, so starting just above it reaches the same positions with a much smaller search
+			int stackHeight = 0;
+			for (int column = 0; column < node.board.GetNumColumns(); ++column) {
+				stackHeight = std::max(stackHeight, node.board.GetColumnHeight(column));
+			}
+			start.y = std::min(start.y, stackHeight + 3);
+		}
+
+		int numPlacements = generator.Generate(node.board, start, request.instantGravity);
+		Candidate* nodeCandidates = &candidates[(size_t)nodeIndex * MoveGenerator::MaxPlacements];
+		int count = 0;
+
+		nodeScratch.batch.Clear(node.board.GetNumColumns());
+		nodeScratch.tableProbes = 0;
+		nodeScratch.tableHits = 0;
+		nodeScratch.tableStores = 0;
+		for (int i = 0; i < numPlacements; ++i) {
+			const Piece& piece = generator.GetPlacement(i).piece;
+			if (IsGameOverPlacement(request, piece)) {
+				continue;
+			}
+
+			nodeScratch.board = node.board;
+			int rowsCleared = PlaceOnBoard(nodeScratch.board, piece);
+
+			Candidate& candidate = nodeCandidates[count++];
+			candidate.node = nodeIndex;
+			candidate.piece = piece;
+			candidate.placement = i;
+
+			//a board reached before (by another placement, another beam node or an earlier search) doesn't need evaluating again
+			int linesCleared = node.linesCleared + rowsCleared;
+			uint64_t key = nodeScratch.board.GetHash();
+			if (table != nullptr) {
+				float boardScore;
+				nodeScratch.tableProbes++;
+
+				if (table->Probe(key, boardScore)) {
+					nodeScratch.tableHits++;
+					candidate.score = AddLinesScore(boardScore, linesCleared);
+					continue;
+				}
+			}
+
+			//the batch scores the board on its own, so the score can be cached whatever was cleared on the way to it
+			int lane = nodeScratch.batch.Add(nodeScratch.board, 0);
+			nodeScratch.batchCandidates[lane] = &candidate;
+			nodeScratch.batchKeys[lane] = key;
+			nodeScratch.batchLines[lane] = linesCleared;
+
+			if (nodeScratch.batch.numBoards == BoardBatch::Size) {
+				ScoreBatch(nodeScratch);
+			}
+		}
+
+		if (nodeScratch.batch.numBoards > 0) {
+			ScoreBatch(nodeScratch);
+		}
+
+		candidateCounts[nodeIndex] = count;
+
+		if (table != nullptr) {
+			table->AddStats(nodeScratch.tableProbes, nodeScratch.tableHits, nodeScratch.tableStores);
+		}
+	}
+
+	int LookaheadAI::PlaceOnBoard(Board& board, const Piece& piece) {
+		Cell cells[4];
+		piece.GetCells(cells);
+		board.LockCells(cells, (uint8_t)piece.type);
+
+		uint64_t fullRows = board.FindFullRows(cells);
+		board.RemoveRows(fullRows);
+		return CountBits(fullRows);
+	}
+
+	bool LookaheadAI::IsGameOverPlacement(const AISearchRequest& request, const Piece& piece) {
+		Cell cells[4];
+		piece.GetCells(cells);
+
+		for (int i = 0; i < 4; ++i) {
+			if (cells[i].y > request.overflowRow) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void LookaheadAI::ScoreBatch(Scratch& batchScratch) const {
+		ScoreBatches(&batchScratch.batch, 1, config.weights, batchScratch.scores);
+
+		for (int lane = 0; lane < batchScratch.batch.numBoards; ++lane) {
+			batchScratch.batchCandidates[lane]->score = AddLinesScore(batchScratch.scores[lane], batchScratch.batchLines[lane]);
+
+			if (table != nullptr) {
+				table->Store(batchScratch.batchKeys[lane], batchScratch.scores[lane]);
+				batchScratch.tableStores++;
+			}
+		}
+
+		batchScratch.batch.Clear(batchScratch.batch.numColumns);
+	}
+
+	float LookaheadAI::AddLinesScore(float boardScore, int linesCleared) const {
+		return boardScore + config.weights.linesCleared * (float)linesCleared;
+	}
+
+	PlacementDriver::PlacementDriver()
+	{
+		target = Piece{ PieceType::T, 0, 0, 0 };
+		start = target;
+		pathLength = 0;
+		nextMove = 0;
+		newPaths = 0;
+		active = false;
+	}
+
+	void PlacementDriver::Start(const AIDecision& decision) {
+		active = decision.found;
+		if (!active) {
+			return;
+		}
+
+		target = decision.target;
+		start = decision.start;
+		pathLength = decision.pathLength;
+		std::copy(decision.path, decision.path + pathLength, path);
+		std::copy(decision.pathStates, decision.pathStates + pathLength, pathStates);
+		nextMove = 0;
+		newPaths = 0;
+	}
+
+	void PlacementDriver::Update(const Game& game, AIControls& controls) {
+		controls.horizontal = 0;
+		controls.softDrop = false;
+		controls.rotate = 0;
+		controls.hardDrop = false;
+
+		if (!active) {
+			return;
+		}
+
+		if (game.NeedsSpawn() || game.IsGameOver()) {
+			active = false;
+			return;
+		}
+
+		//the tetromino may have made several moves since the last update (e.g., more than 1 step in a frame), so look for it further along the path
+		const Piece& piece = game.GetPiece();
+		if (!SamePiece(piece, nextMove == 0 ? start : pathStates[nextMove - 1])) {
+			int reached = -1;
+			for (int i = nextMove; i < pathLength && reached < 0; ++i) {
+				reached = SamePiece(piece, pathStates[i]) ? i : -1;
+			}
+
+			if (reached >= 0) {
+				nextMove = reached + 1;
+			}
+			else if (!FindNewPath(game)) {
+				//the target can't be reached any more, so drop where it is rather than wait for gravity
+				controls.hardDrop = true;
+				active = false;
+				return;
+			}
+		}
+
+		//the target is a resting position, so hard dropping there locks it in place
+		if (nextMove >= pathLength) {
+			controls.hardDrop = true;
+			active = false;
+			return;
+		}
+
+		switch (path[nextMove]) {
+		case MoveInput::Left:
+			controls.horizontal = -1;
+			break;
+		case MoveInput::Right:
+			controls.horizontal = 1;
+			break;
+		case MoveInput::SoftDrop:
+			controls.softDrop = true;
+			break;
+		case MoveInput::RotateClockwise:
+			controls.rotate = 1;
+			break;
+		case MoveInput::RotateAntiClockwise:
+			controls.rotate = -1;
+			break;
+		default:
+			break;
+		}
+	}
+
+	bool PlacementDriver::FindNewPath(const Game& game) {
+		if (++newPaths > MaxNewPaths) {
+			return false;
+		}
+
+		start = game.GetPiece();
+		int numPlacements = generator.Generate(game.GetBoard(), start, game.HasInstantGravity());
+
+		for (int i = 0; i < numPlacements; ++i) {
+			if (SameCells(generator.GetPlacement(i).piece, target)) {
+				pathLength = std::min(generator.GetPath(i, path, MaxAIPathLength, pathStates), MaxAIPathLength);
+				nextMove = 0;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void PlayGameWithAI(Game& game, LookaheadAI& ai, int maxPieces) {
+		//the driver and search state are too big for the stack of a pool thread to hold comfortably
+		std::unique_ptr<PlacementDriver> driver(new PlacementDriver());
+		std::unique_ptr<AISearchRequest> request(new AISearchRequest());
+		std::unique_ptr<AIDecision> decision(new AIDecision());
+
+		for (int pieces = 0; pieces < maxPieces && !game.IsGameOver(); ++pieces) {
+			game.SpawnNext();
+			if (game.IsGameOver()) {
+				break;
+			}
+
+			request->Capture(game, ai.GetConfig().previewDepth);
+			ai.Search(*request, *decision);
+			driver->Start(*decision);
+
+			//use the controls the driver asks for, only passing soft drop changes on like ATetrisBlock does
+			bool softDrop = false;
+			while (!game.NeedsSpawn() && !game.IsGameOver()) {
+				AIControls controls;
+				driver->Update(game, controls);
+
+				if (controls.horizontal != 0) {
+					game.ApplyInput(InputType::Horizontal, controls.horizontal);
+					game.ApplyInput(InputType::Horizontal, 0);
+				}
+
+				if (controls.softDrop != softDrop) {
+					softDrop = controls.softDrop;
+					game.ApplyInput(InputType::SoftDrop, softDrop ? 1 : 0);
+				}
+
+				if (controls.rotate != 0) {
+					game.ApplyInput(InputType::Rotate, controls.rotate);
+				}
+
+				if (controls.hardDrop) {
+					game.ApplyInput(InputType::HardDrop, 0);
+					break;
+				}
+
+				game.Step();
+			}
+
+			game.ApplyInput(InputType::SoftDrop, 0);
+			game.TakeEvents();
+		}
+	}
+}
@@ -0,0 +1,263 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "TetrisEvaluator.h"
+#include "TetrisGame.h"
+#include "TetrisMoveGenerator.h"
+#include "TetrisThreadPool.h"
+#include "TetrisTranspositionTable.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace TetrisCore
+{
+	struct AIConfig
+	{
+		//boards kept at each depth of the beam search
+		int beamWidth = 32;
+
+		//amount of preview tetrominoes searched after the falling one
+		int previewDepth = 3;
+
+		//seconds the search may take before it returns the best move found so far, 0 = no limit (the same result every time)
+		double timeBudget = 0.002;
+
+		//size of the transposition table as a power of 2 (14 = 16384 entries, 256KB, small enough to stay in cache), 0 = no table
+		//scores only depend on the board, so the table is kept between searches and later searches reuse the boards of earlier ones
+		int transpositionTableBits = 14;
+
+		EvaluatorWeights weights;
+	};
+
+	//longest path to a placement the AI keeps
+	static const int MaxAIPathLength = 128;
+
+	//where the AI wants the falling tetromino to go and how to get it there
+	struct AIDecision
+	{
+		//false if the tetromino has nowhere to go
+		bool found;
+
+		//position the tetromino should lock in
+		Piece target;
+
+		//position of the tetromino when the search started
+		Piece start;
+
+		//moves that take the tetromino from the start to the target, and its position after each one
+		MoveInput path[MaxAIPathLength];
+		Piece pathStates[MaxAIPathLength];
+		int pathLength;
+
+		//amount of tetrominoes searched (1 = only the falling one), boards scored and time taken
+		int depthSearched;
+		int boardsEvaluated;
+		double seconds;
+
+		//boards looked up in the transposition table during this search, and how many were already scored
+		uint64_t tableProbes;
+		uint64_t tableHits;
+	};
+
+	//everything the AI needs to know about a game to search it, copied so it can search on another thread while the game plays on
+	struct AISearchRequest
+	{
+		Board board;
+
+		//the tetromino to place, and where it spawns after it
+		Piece piece;
+		PieceType preview[PieceRandomizer::PreviewSize];
+		int numPreview;
+		int spawnColumn;
+		int spawnRow;
+
+		//placements with a block above this row are skipped, as locking there is game over
+		int overflowRow;
+
+		//true if tetrominoes fall to the ground after every move (i.e., 20G)
+		bool instantGravity;
+
+		//copies the state of the game, with up to numPreview tetrominoes from the preview queue
+		void Capture(const Game& game, int numPreview);
+	};
+
+	//beam search over the falling tetromino and the preview queue. Each depth places every tetromino of the beam in every reachable
+	//position, scores the boards in SIMD batches and keeps the best beamWidth boards. Beam boards are expanded in parallel on the pool
+	class LookaheadAI
+	{
+	public:
+		//the pool is used for the branches of the search and to search in the background. Without a pool everything runs on the calling thread
+		explicit LookaheadAI(ThreadPool* pool = nullptr, const AIConfig& config = AIConfig());
+
+		//waits for a background search to finish, as it uses this object
+		~LookaheadAI();
+
+		LookaheadAI(const LookaheadAI&) = delete;
+		LookaheadAI& operator=(const LookaheadAI&) = delete;
+
+		//searches for the best placement of the falling tetromino, blocking until done or out of time
+		void Search(const AISearchRequest& request, AIDecision& decision);
+
+		//starts a search on the pool and returns straight away. Returns false if a search is already running
+		bool StartSearch(const Game& game);
+
+		//gets the result of the background search if it has finished. Returns false while it is still running (or none was started)
+		bool TakeDecision(AIDecision& decision);
+
+		bool IsSearching() const;
+
+		const AIConfig& GetConfig() const { return config; }
+
+		//gets the totals of the transposition table across every search so far (all 0 without a table)
+		TranspositionStats GetTableStats() const;
+
+	private:
+		//a board at one depth of the beam
+		struct BeamNode
+		{
+			Board board;
+
+			//placement of the falling tetromino this board came from
+			int rootPlacement;
+
+			//rows cleared on the way to this board
+			int linesCleared;
+		};
+
+		//a placement on a beam board, kept small as every placement at a depth is scored before the best are picked
+		struct Candidate
+		{
+			float score;
+
+			//beam node it was placed on and its position
+			int node;
+			Piece piece;
+
+			//index of the placement in the move generator, used to find the path of the falling tetromino
+			int placement;
+		};
+
+		//memory used by 1 thread while expanding beam nodes
+		struct Scratch
+		{
+			MoveGenerator generator;
+			BoardBatch batch;
+			Board board;
+			float scores[BoardBatch::Size];
+
+			//candidate, board hash and rows cleared on the way of each lane of the batch
+			Candidate* batchCandidates[BoardBatch::Size];
+			uint64_t batchKeys[BoardBatch::Size];
+			int batchLines[BoardBatch::Size];
+
+			//transposition table use while expanding the current node
+			uint64_t tableProbes;
+			uint64_t tableHits;
+			uint64_t tableStores;
+		};
+
+		//places the tetromino in every position on a beam node's board and scores the results into its block of candidates
+		void ExpandNode(const AISearchRequest& request, int depth, int nodeIndex, Scratch& scratch);
+
+		//locks the tetromino into the board and clears full rows. Returns the amount of rows cleared
+		static int PlaceOnBoard(Board& board, const Piece& piece);
+
+		//returns true if locking the tetromino there would end the game
+		static bool IsGameOverPlacement(const AISearchRequest& request, const Piece& piece);
+
+		//scores the batch, writes the scores to the candidates that were added to it and the transposition table, and empties it
+		void ScoreBatch(Scratch& scratch) const;
+
+		//adds the score of the rows cleared on the way to a board to the score of the board itself
+		float AddLinesScore(float boardScore, int linesCleared) const;
+
+		AIConfig config;
+		ThreadPool* pool;
+
+		//one per thread that can take part in a ParallelFor
+		std::vector<std::unique_ptr<Scratch>> scratch;
+
+		//scores of boards already evaluated, keyed by their Zobrist hash. Shared by every thread of the search
+		std::unique_ptr<TranspositionTable> table;
+
+		//finds the paths of the falling tetromino, kept apart from the scratch so its placements are still there at the end
+		MoveGenerator rootGenerator;
+
+		//current beam and the next one being built
+		std::vector<BeamNode> beam;
+		std::vector<BeamNode> nextBeam;
+
+		//every candidate of a depth, MoveGenerator::MaxPlacements per beam node
+		std::vector<Candidate> candidates;
+		std::vector<int> candidateCounts;
+
+		//indices of the candidates, sorted to find the best
+		std::vector<int> order;
+
+		//the background search
+		mutable std::mutex searchMutex;
+		std::condition_variable searchDone;
+		AISearchRequest pendingRequest;
+		AIDecision pendingDecision;
+		bool searching;
+		bool decisionReady;
+	};
+
+	//controls the AI wants used before the next step, passed to the same input functions as a player
+	struct AIControls
+	{
+		//-1 = tap left, 1 = tap right, 0 = neither. Taps are pressed and released straight away, as every press moves once but holding waits for auto shift
+		int horizontal;
+		bool softDrop;
+
+		//-1 = rotate anti clockwise, 1 = rotate clockwise, 0 = no rotation
+		int rotate;
+		bool hardDrop;
+	};
+
+	//most times the driver looks for a new path to the same target before giving up and dropping the tetromino where it is
+	static const int MaxNewPaths = 8;
+
+	//drives the falling tetromino along the path of an AI decision, one input at a time like a player tapping the controls
+	//if gravity or a missed input takes the tetromino off the path, a new path to the same target is found from where it is
+	class PlacementDriver
+	{
+	public:
+		PlacementDriver();
+
+		//starts driving the falling tetromino to the target of the decision
+		void Start(const AIDecision& decision);
+
+		void Stop() { active = false; }
+
+		bool IsActive() const { return active; }
+
+		//works out which controls to use before the next step
+		void Update(const Game& game, AIControls& controls);
+
+	private:
+		//finds a new path to the target from the tetromino's current position. Returns false if the target can't be reached
+		bool FindNewPath(const Game& game);
+
+		MoveGenerator generator;
+		Piece target;
+		Piece start;
+		MoveInput path[MaxAIPathLength];
+		Piece pathStates[MaxAIPathLength];
+		int pathLength;
+
+		//index of the next move to make
+		int nextMove;
+
+		//amount of new paths found for this tetromino. Limited, as kicks that lift the tetromino can otherwise loop forever
+		int newPaths;
+		bool active;
+	};
+
+	//plays the game with the AI driving every tetromino through the controls, as ATetrisBlock does, until it tops out
+	//or maxPieces tetrominoes have been placed. The game must already be initialised
+	void PlayGameWithAI(Game& game, LookaheadAI& ai, int maxPieces);
+}
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace TetrisCore
+{
+	//amount of set bits in the mask
+	inline int CountBits(uint64_t mask)
+	{
+#if defined(_MSC_VER)
+		return (int)__popcnt64(mask);
+#else
+		return __builtin_popcountll(mask);
+#endif
+	}
+
+	//index of the lowest set bit. The mask must not be 0
+	inline int CountTrailingZeros(uint64_t mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, mask);
+		return (int)index;
+#else
+		return __builtin_ctzll(mask);
+#endif
+	}
+
+	//index of the highest set bit. The mask must not be 0
+	inline int HighestBit(uint64_t mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, mask);
+		return (int)index;
+#else
+		return 63 - __builtin_clzll(mask);
+#endif
+	}
+}
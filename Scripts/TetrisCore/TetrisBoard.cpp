@@ -0,0 +1,315 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TetrisBoard.h"
+#include "TetrisBits.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace TetrisCore
+{
+	Board::Board()
+	{
+		Init(10);
+	}
+
+	void Board::Init(int columns) {
+		//rows are stored as 16 bit masks, so the playfield can't be wider than that
+		numColumns = std::max(1, std::min(columns, MaxColumns));
+		Reset();
+	}
+
+	void Board::Reset() {
+		std::memset(rows, 0, sizeof(rows));
+		std::memset(rowFill, 0, sizeof(rowFill));
+		std::memset(columnMasks, 0, sizeof(columnMasks));
+		std::memset(columnHeights, 0, sizeof(columnHeights));
+		std::memset(cellPieces, 0, sizeof(cellPieces));
+		hash = 0;
+	}
+
+	bool Board::IsOccupied(int column, int row) const {
+		if (column < 0 || column >= numColumns || row < 0 || row >= MaxRows) {
+			return false;
+		}
+
+		return (rows[row] & (1 << column)) != 0;
+	}
+
+	bool Board::IsOutOfBounds(int column, int row) const {
+		return column < 0 || column >= numColumns || row < 0;
+	}
+
+	void Board::SetCell(int column, int row) {
+		if (IsOutOfBounds(column, row) || row >= MaxRows) {
+			return;
+		}
+
+		//only count the block if the cell was empty
+		if ((rows[row] & (1 << column)) == 0) {
+			rows[row] |= (uint16_t)(1 << column);
+			rowFill[row]++;
+			columnMasks[column] |= (uint64_t)1 << row;
+			columnHeights[column] = (uint8_t)std::max((int)columnHeights[column], row + 1);
+			hash ^= ZobristKeys.cells[row][column];
+		}
+	}
+
+	void Board::ClearCell(int column, int row) {
+		if (IsOutOfBounds(column, row) || row >= MaxRows) {
+			return;
+		}
+
+		if ((rows[row] & (1 << column)) != 0) {
+			rows[row] &= (uint16_t)~(1 << column);
+			rowFill[row]--;
+			columnMasks[column] &= ~((uint64_t)1 << row);
+			columnHeights[column] = (uint8_t)(columnMasks[column] != 0 ? HighestBit(columnMasks[column]) + 1 : 0);
+			hash ^= ZobristKeys.cells[row][column];
+		}
+	}
+
+	bool Board::BuildPieceMask(const Cell cells[4], uint16_t pieceRows[4], int& baseRow) const {
+		bool inBounds = true;
+
+		//tetromino rows are relative to its lowest cell, so a tetromino always fits in 4 row masks
+		baseRow = std::min(std::min(cells[0].y, cells[1].y), std::min(cells[2].y, cells[3].y));
+
+		for (int i = 0; i < 4; ++i) {
+			pieceRows[i] = 0;
+		}
+
+		for (int i = 0; i < 4; ++i) {
+			if (IsOutOfBounds(cells[i].x, cells[i].y)) {
+				inBounds = false;
+				continue;
+			}
+
+			pieceRows[cells[i].y - baseRow] |= (uint16_t)(1 << cells[i].x);
+		}
+
+		return inBounds;
+	}
+
+	bool Board::Overlaps(const Cell cells[4]) const {
+		uint16_t pieceRows[4];
+		int baseRow;
+		BuildPieceMask(cells, pieceRows, baseRow);
+
+		//mask each row of the tetromino against the landed blocks on the same row
+		for (int i = 0; i < 4; ++i) {
+			int row = baseRow + i;
+			if (row >= 0 && row < MaxRows && (rows[row] & pieceRows[i]) != 0) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool Board::Collides(const Cell cells[4]) const {
+		uint16_t pieceRows[4];
+		int baseRow;
+		if (!BuildPieceMask(cells, pieceRows, baseRow)) {
+			return true;
+		}
+
+		for (int i = 0; i < 4; ++i) {
+			int row = baseRow + i;
+			if (row < MaxRows && (rows[row] & pieceRows[i]) != 0) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	uint32_t Board::FindFittingOffsets(const Cell cells[4], const Cell* offsets, int numOffsets) const {
+		//build the tetromino once as 4 row lanes of a 64 bit mask, relative to its lowest row and leftmost column
+		int minX = std::min(std::min(cells[0].x, cells[1].x), std::min(cells[2].x, cells[3].x));
+		int maxX = std::max(std::max(cells[0].x, cells[1].x), std::max(cells[2].x, cells[3].x));
+		int minY = std::min(std::min(cells[0].y, cells[1].y), std::min(cells[2].y, cells[3].y));
+		int width = maxX - minX + 1;
+
+		uint64_t pieceLanes = 0;
+		for (int i = 0; i < 4; ++i) {
+			pieceLanes |= (uint64_t)1 << ((cells[i].y - minY) * 16 + (cells[i].x - minX));
+		}
+
+		uint32_t fitting = 0;
+		for (int i = 0; i < numOffsets; ++i) {
+			int column = minX + offsets[i].x;
+			int row = minY + offsets[i].y;
+
+			//a wall or the ground is in the way
+			if (column < 0 || column + width > numColumns || row < 0) {
+				continue;
+			}
+
+			//shifting by less than the free space in a row can't carry a bit into the next lane, so all 4 rows are tested with one AND
+			if ((GetRowLanes(row) & (pieceLanes << column)) == 0) {
+				fitting |= 1u << i;
+			}
+		}
+
+		return fitting;
+	}
+
+	uint64_t Board::GetRowLanes(int row) const {
+		uint64_t lanes = 0;
+		for (int i = 0; i < 4 && row + i < MaxRows; ++i) {
+			lanes |= (uint64_t)rows[row + i] << (i * 16);
+		}
+
+		return lanes;
+	}
+
+	int Board::GetDropDistance(const Cell cells[4]) const {
+		int distance = MaxRows;
+
+		for (int i = 0; i < 4; ++i) {
+			const Cell& cell = cells[i];
+			if (IsOutOfBounds(cell.x, cell.y)) {
+				return 0;
+			}
+
+			//if the cell is above the surface of its column it falls onto the surface, otherwise find the highest block below it
+			int landingRow = columnHeights[cell.x];
+			if (cell.y < landingRow) {
+				uint64_t below = columnMasks[cell.x] & (((uint64_t)1 << cell.y) - 1);
+				landingRow = below != 0 ? HighestBit(below) + 1 : 0;
+			}
+
+			distance = std::min(distance, cell.y - landingRow);
+		}
+
+		return std::max(distance, 0);
+	}
+
+	void Board::LockCells(const Cell cells[4], uint8_t pieceType) {
+		for (int i = 0; i < 4; ++i) {
+			SetCell(cells[i].x, cells[i].y);
+
+			if (!IsOutOfBounds(cells[i].x, cells[i].y) && cells[i].y < MaxRows) {
+				cellPieces[cells[i].y][cells[i].x] = pieceType;
+			}
+		}
+	}
+
+	uint64_t Board::FindFullRows(const Cell cells[4]) const {
+		uint64_t fullRows = 0;
+
+		//only the rows the tetromino landed on can have become full, so check their counters
+		for (int i = 0; i < 4; ++i) {
+			int row = cells[i].y;
+			if (row >= 0 && row < MaxRows && rowFill[row] >= numColumns) {
+				fullRows |= (uint64_t)1 << row;
+			}
+		}
+
+		return fullRows;
+	}
+
+	void Board::RemoveRows(uint64_t rowsToRemove) {
+		if (rowsToRemove == 0) {
+			return;
+		}
+
+		//copy each remaining row straight to its final position, starting from the lowest removed row
+		int firstRow = CountTrailingZeros(rowsToRemove);
+		int writeRow = firstRow;
+
+		//every row from the lowest removed row up changes, so take their blocks out of the hash now and add them back once they've moved
+		for (int row = firstRow; row < MaxRows; ++row) {
+			hash ^= HashRow(row, rows[row]);
+		}
+
+		for (int readRow = writeRow; readRow < MaxRows; ++readRow) {
+			if (rowsToRemove & ((uint64_t)1 << readRow)) {
+				continue;
+			}
+
+			rows[writeRow] = rows[readRow];
+			rowFill[writeRow] = rowFill[readRow];
+			std::memcpy(cellPieces[writeRow], cellPieces[readRow], sizeof(cellPieces[readRow]));
+			writeRow++;
+		}
+
+		//then empty the rows left at the top
+		for (; writeRow < MaxRows; ++writeRow) {
+			rows[writeRow] = 0;
+			rowFill[writeRow] = 0;
+		}
+
+		for (int row = firstRow; row < MaxRows; ++row) {
+			hash ^= HashRow(row, rows[row]);
+		}
+
+		//remove the same rows from each column mask, highest row first so the lower row indexes stay valid
+		for (int column = 0; column < numColumns; ++column) {
+			uint64_t mask = columnMasks[column];
+			uint64_t removing = rowsToRemove;
+
+			while (removing != 0) {
+				int row = HighestBit(removing);
+				uint64_t rowsBelow = ((uint64_t)1 << row) - 1;
+				mask = (mask & rowsBelow) | ((mask >> 1) & ~rowsBelow);
+				removing &= rowsBelow;
+			}
+
+			columnMasks[column] = mask;
+			columnHeights[column] = (uint8_t)(mask != 0 ? HighestBit(mask) + 1 : 0);
+		}
+	}
+
+	uint64_t Board::HashRow(int row, uint16_t mask) {
+		uint64_t rowHash = 0;
+		while (mask != 0) {
+			rowHash ^= ZobristKeys.cells[row][CountTrailingZeros(mask)];
+			mask &= (uint16_t)(mask - 1);
+		}
+
+		return rowHash;
+	}
+
+	uint16_t Board::GetRow(int row) const {
+		if (row < 0 || row >= MaxRows) {
+			return 0;
+		}
+
+		return rows[row];
+	}
+
+	int Board::GetRowFill(int row) const {
+		if (row < 0 || row >= MaxRows) {
+			return 0;
+		}
+
+		return rowFill[row];
+	}
+
+	int Board::GetColumnHeight(int column) const {
+		if (column < 0 || column >= numColumns) {
+			return 0;
+		}
+
+		return columnHeights[column];
+	}
+
+	uint64_t Board::GetColumnMask(int column) const {
+		if (column < 0 || column >= numColumns) {
+			return 0;
+		}
+
+		return columnMasks[column];
+	}
+
+	uint8_t Board::GetCellPiece(int column, int row) const {
+		if (!IsOccupied(column, row)) {
+			return 0;
+		}
+
+		return cellPieces[row][column];
+	}
+}
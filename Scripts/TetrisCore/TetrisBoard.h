@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "TetrisZobrist.h"
+
+#include <cstdint>
+
+//engine independent tetris rules. Nothing in this namespace depends on Unreal, so it can be built and run headless
+namespace TetrisCore
+{
+	//column (x, counted from the left wall) and row (y, counted from the ground) of a cell in the playfield
+	struct Cell
+	{
+		int x;
+		int y;
+	};
+
+	//bitboard representation of the playfield. Each row is stored as a bitmask where bit 0 is the leftmost column
+	class Board
+	{
+	public:
+		//widest row that can be stored in a row bitmask
+		static constexpr int MaxColumns = 16;
+
+		//amount of rows stored, cells above this are always treated as empty
+		static constexpr int MaxRows = 48;
+
+		Board();
+
+		//clears the board and sets how many columns are in the playfield
+		void Init(int columns);
+
+		//removes all landed blocks from the board
+		void Reset();
+
+		//returns true if a landed block is at the cell. Cells outside the board are never occupied
+		bool IsOccupied(int column, int row) const;
+
+		//returns true if the cell is to the left/right of the walls or below the ground
+		bool IsOutOfBounds(int column, int row) const;
+
+		//marks the cell as holding a landed block
+		void SetCell(int column, int row);
+
+		//marks the cell as empty
+		void ClearCell(int column, int row);
+
+		//returns true if any of the 4 cells of a tetromino overlaps a landed block
+		bool Overlaps(const Cell cells[4]) const;
+
+		//returns true if any of the 4 cells of a tetromino overlaps a landed block or is outside the playfield
+		bool Collides(const Cell cells[4]) const;
+
+		//tests the cells moved by each offset in one pass. Returns a bitmask where bit i is set if the cells moved by offsets[i] don't collide
+		uint32_t FindFittingOffsets(const Cell cells[4], const Cell* offsets, int numOffsets) const;
+
+		//gets the amount of rows the cells can fall before one of them lands on a block or the ground
+		int GetDropDistance(const Cell cells[4]) const;
+
+		//adds the 4 cells of a landed tetromino to the board, remembering which type of tetromino it was
+		void LockCells(const Cell cells[4], uint8_t pieceType);
+
+		//returns a bitmask (bit = row) of the full rows among the rows covered by the cells
+		uint64_t FindFullRows(const Cell cells[4]) const;
+
+		//deletes every row in the bitmask and moves the rows above down in a single pass
+		void RemoveRows(uint64_t rowsToRemove);
+
+		//gets the bitmask of a row
+		uint16_t GetRow(int row) const;
+
+		//gets the amount of landed blocks on a row
+		int GetRowFill(int row) const;
+
+		//gets the row above the highest landed block in the column (0 if the column is empty)
+		int GetColumnHeight(int column) const;
+
+		//gets the bitmask (bit = row) of the landed blocks in the column
+		uint64_t GetColumnMask(int column) const;
+
+		//gets the type of tetromino that landed on the cell
+		uint8_t GetCellPiece(int column, int row) const;
+
+		//gets the amount of columns in the playfield
+		int GetNumColumns() const { return numColumns; }
+
+		//gets the Zobrist hash of the landed blocks. Boards with the same blocks have the same hash, whatever order they were placed in
+		uint64_t GetHash() const { return hash; }
+
+	private:
+		//builds a bitmask for each row the tetromino covers, starting from its lowest row. Returns false if a cell is outside the playfield
+		bool BuildPieceMask(const Cell cells[4], uint16_t pieceRows[4], int& baseRow) const;
+
+		//gets the XOR of the Zobrist keys of every landed block on the row
+		static uint64_t HashRow(int row, uint16_t mask);
+
+		//packs the bitmasks of 4 rows, starting at row, into a 16 bit lane each. Rows above the board are empty
+		uint64_t GetRowLanes(int row) const;
+
+		//one bitmask per row, bit set = landed block
+		uint16_t rows[MaxRows];
+
+		//amount of landed blocks on each row, updated whenever a cell is set or cleared so full rows don't need counting
+		uint8_t rowFill[MaxRows];
+
+		//one bitmask per column, bit set = landed block on that row. Kept up to date with the rows so drops don't need to scan
+		uint64_t columnMasks[MaxColumns];
+
+		//row above the highest landed block of each column
+		uint8_t columnHeights[MaxColumns];
+
+		//type of tetromino each landed block came from, used to draw the stack
+		uint8_t cellPieces[MaxRows][MaxColumns];
+
+		//XOR of the Zobrist keys of every landed block, updated whenever a cell is set or cleared and when rows are removed
+		uint64_t hash;
+
+		//amount of columns in the playfield
+		int numColumns;
+	};
+
+	static_assert(Board::MaxRows <= ZobristRows && Board::MaxColumns <= ZobristColumns, "Zobrist table doesn't cover the board");
+}
@@ -0,0 +1,280 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TetrisEvaluator.h"
+#include "TetrisBits.h"
+
+#include <cstring>
+
+//AVX2 is only used when the whole build targets it (e.g., -mavx2 or /arch:AVX2, see TETRISCORE_AVX2 in CMakeLists.txt)
+//SSE2 is part of every x64 CPU, so it is the default on x64
+#if defined(__AVX2__)
+#define TETRIS_EVALUATOR_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TETRIS_EVALUATOR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace TetrisCore
+{
+	void BoardBatch::Clear(int columns) {
+		std::memset(rows, 0, sizeof(rows));
+		std::memset(linesCleared, 0, sizeof(linesCleared));
+		numBoards = 0;
+		numColumns = columns;
+		highestRow = 0;
+	}
+
+	int BoardBatch::Add(const Board& board, int rowsCleared) {
+		if (numBoards >= Size) {
+			return -1;
+		}
+
+		int height = 0;
+		for (int column = 0; column < board.GetNumColumns(); ++column) {
+			int columnHeight = board.GetColumnHeight(column);
+			height = columnHeight > height ? columnHeight : height;
+		}
+
+		int lane = numBoards++;
+		for (int row = 0; row < height; ++row) {
+			rows[row][lane] = board.GetRow(row);
+		}
+
+		linesCleared[lane] = (uint8_t)rowsCleared;
+		highestRow = height > highestRow ? height : highestRow;
+		return lane;
+	}
+
+	namespace
+	{
+#if TETRIS_EVALUATOR_AVX2 || TETRIS_EVALUATOR_SSE2
+		//the operations the SIMD evaluator needs on 16 bit lanes, so the same code runs on 256 bit (AVX2) or 128 bit (SSE2) registers
+#if TETRIS_EVALUATOR_AVX2
+		struct SimdOps
+		{
+			typedef __m256i Vector;
+			static constexpr int Lanes = 16;
+
+			static Vector Load(const uint16_t* lanes) { return _mm256_load_si256((const __m256i*)lanes); }
+			static void Store(uint16_t* lanes, Vector value) { _mm256_storeu_si256((__m256i*)lanes, value); }
+			static Vector Set(int value) { return _mm256_set1_epi16((short)value); }
+			static Vector Zero() { return _mm256_setzero_si256(); }
+			static Vector Or(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+			static Vector And(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+			static Vector AndNot(Vector a, Vector b) { return _mm256_andnot_si256(a, b); }
+			static Vector Xor(Vector a, Vector b) { return _mm256_xor_si256(a, b); }
+			static Vector Add(Vector a, Vector b) { return _mm256_add_epi16(a, b); }
+			static Vector Sub(Vector a, Vector b) { return _mm256_sub_epi16(a, b); }
+			static Vector ShiftLeft(Vector a, int bits) { return _mm256_slli_epi16(a, bits); }
+			static Vector ShiftRight(Vector a, int bits) { return _mm256_srli_epi16(a, bits); }
+			static Vector Equal(Vector a, Vector b) { return _mm256_cmpeq_epi16(a, b); }
+		};
+#else
+		struct SimdOps
+		{
+			typedef __m128i Vector;
+			static constexpr int Lanes = 8;
+
+			static Vector Load(const uint16_t* lanes) { return _mm_load_si128((const __m128i*)lanes); }
+			static void Store(uint16_t* lanes, Vector value) { _mm_storeu_si128((__m128i*)lanes, value); }
+			static Vector Set(int value) { return _mm_set1_epi16((short)value); }
+			static Vector Zero() { return _mm_setzero_si128(); }
+			static Vector Or(Vector a, Vector b) { return _mm_or_si128(a, b); }
+			static Vector And(Vector a, Vector b) { return _mm_and_si128(a, b); }
+			static Vector AndNot(Vector a, Vector b) { return _mm_andnot_si128(a, b); }
+			static Vector Xor(Vector a, Vector b) { return _mm_xor_si128(a, b); }
+			static Vector Add(Vector a, Vector b) { return _mm_add_epi16(a, b); }
+			static Vector Sub(Vector a, Vector b) { return _mm_sub_epi16(a, b); }
+			static Vector ShiftLeft(Vector a, int bits) { return _mm_slli_epi16(a, bits); }
+			static Vector ShiftRight(Vector a, int bits) { return _mm_srli_epi16(a, bits); }
+			static Vector Equal(Vector a, Vector b) { return _mm_cmpeq_epi16(a, b); }
+		};
+#endif
+
+		typedef SimdOps::Vector Vector;
+
+		//amount of set bits in each 16 bit lane, counted in parallel as SSE2 and AVX2 have no popcount for lanes
+		inline Vector CountLaneBits(Vector value) {
+			value = SimdOps::Sub(value, SimdOps::And(SimdOps::ShiftRight(value, 1), SimdOps::Set(0x5555)));
+			value = SimdOps::Add(SimdOps::And(value, SimdOps::Set(0x3333)), SimdOps::And(SimdOps::ShiftRight(value, 2), SimdOps::Set(0x3333)));
+			value = SimdOps::And(SimdOps::Add(value, SimdOps::ShiftRight(value, 4)), SimdOps::Set(0x0f0f));
+			return SimdOps::And(SimdOps::Add(value, SimdOps::ShiftRight(value, 8)), SimdOps::Set(0x001f));
+		}
+
+		//counts the features of the boards in lanes firstLane to firstLane + SimdOps::Lanes of the batch
+		//each board is scanned from the top down, keeping a mask of the columns that have a block at or above the current row
+		void EvaluateLanesSimd(const BoardBatch& batch, int firstLane, BoardFeatures* features) {
+			const int columns = batch.numColumns;
+			const Vector full = SimdOps::Set((1 << columns) - 1);
+			const Vector pairs = SimdOps::Set((1 << (columns - 1)) - 1);
+			const Vector leftWall = SimdOps::Set(1);
+			const Vector rightWall = SimdOps::Set(1 << (columns - 1));
+			const Vector one = SimdOps::Set(1);
+			const Vector zero = SimdOps::Zero();
+
+			Vector covered = zero;
+			Vector previousRow = zero;
+			Vector aggregateHeight = zero;
+			Vector holes = zero;
+			Vector bumpiness = zero;
+			Vector rowTransitions = zero;
+			Vector columnTransitions = zero;
+			Vector wellCells = zero;
+			Vector clearableLines = zero;
+
+			for (int row = batch.highestRow - 1; row >= 0; --row) {
+				Vector cells = SimdOps::Load(&batch.rows[row][firstLane]);
+				Vector coveredAbove = covered;
+				covered = SimdOps::Or(covered, cells);
+				Vector empty = SimdOps::AndNot(cells, full);
+
+				//a column is as high as the amount of rows it is covered on, and neighbouring columns differ by the rows where only 1 is covered
+				aggregateHeight = SimdOps::Add(aggregateHeight, CountLaneBits(covered));
+				holes = SimdOps::Add(holes, CountLaneBits(SimdOps::And(empty, coveredAbove)));
+				bumpiness = SimdOps::Add(bumpiness, CountLaneBits(SimdOps::And(SimdOps::Xor(covered, SimdOps::ShiftRight(covered, 1)), pairs)));
+				columnTransitions = SimdOps::Add(columnTransitions, CountLaneBits(SimdOps::Xor(cells, previousRow)));
+
+				//transitions between neighbouring columns, plus 1 for each wall next to an empty cell. Only rows up to the top of each board count
+				Vector transitions = CountLaneBits(SimdOps::And(SimdOps::Xor(cells, SimdOps::ShiftRight(cells, 1)), pairs));
+				transitions = SimdOps::Add(transitions, SimdOps::And(empty, leftWall));
+				transitions = SimdOps::Add(transitions, SimdOps::ShiftRight(SimdOps::And(empty, rightWall), columns - 1));
+				rowTransitions = SimdOps::Add(rowTransitions, SimdOps::AndNot(SimdOps::Equal(covered, zero), transitions));
+
+				//open empty cells with something on both sides
+				Vector filledLeft = SimdOps::Or(SimdOps::ShiftLeft(cells, 1), leftWall);
+				Vector filledRight = SimdOps::Or(SimdOps::ShiftRight(cells, 1), rightWall);
+				Vector wells = SimdOps::And(SimdOps::AndNot(coveredAbove, empty), SimdOps::And(filledLeft, filledRight));
+				wellCells = SimdOps::Add(wellCells, CountLaneBits(wells));
+
+				//the gap is a single bit if clearing its lowest bit leaves nothing, and open if nothing above covers it
+				Vector singleGap = SimdOps::AndNot(SimdOps::Equal(empty, zero), SimdOps::Equal(SimdOps::And(empty, SimdOps::Sub(empty, one)), zero));
+				Vector openGap = SimdOps::Equal(SimdOps::And(empty, coveredAbove), zero);
+				clearableLines = SimdOps::Sub(clearableLines, SimdOps::And(singleGap, openGap));
+
+				previousRow = cells;
+			}
+
+			//the floor counts as filled, so every empty cell on the bottom row is a transition
+			Vector bottomRow = SimdOps::Load(&batch.rows[0][firstLane]);
+			columnTransitions = SimdOps::Add(columnTransitions, CountLaneBits(SimdOps::AndNot(bottomRow, full)));
+
+			uint16_t lanes[8][SimdOps::Lanes];
+			SimdOps::Store(lanes[0], aggregateHeight);
+			SimdOps::Store(lanes[1], holes);
+			SimdOps::Store(lanes[2], bumpiness);
+			SimdOps::Store(lanes[3], rowTransitions);
+			SimdOps::Store(lanes[4], columnTransitions);
+			SimdOps::Store(lanes[5], wellCells);
+			SimdOps::Store(lanes[6], clearableLines);
+
+			for (int lane = 0; lane < SimdOps::Lanes; ++lane) {
+				BoardFeatures& board = features[lane];
+				board.aggregateHeight = (int16_t)lanes[0][lane];
+				board.holes = (int16_t)lanes[1][lane];
+				board.bumpiness = (int16_t)lanes[2][lane];
+				board.rowTransitions = (int16_t)lanes[3][lane];
+				board.columnTransitions = (int16_t)lanes[4][lane];
+				board.wellCells = (int16_t)lanes[5][lane];
+				board.clearableLines = (int16_t)lanes[6][lane];
+				board.linesCleared = batch.linesCleared[firstLane + lane];
+			}
+		}
+#endif
+
+		//counts the features of 1 board of the batch the same way as EvaluateLanesSimd, one row at a time
+		void EvaluateLaneScalar(const BoardBatch& batch, int lane, BoardFeatures& features) {
+			const int columns = batch.numColumns;
+			const uint32_t full = (1u << columns) - 1;
+			const uint32_t pairs = (1u << (columns - 1)) - 1;
+			const uint32_t rightWall = 1u << (columns - 1);
+
+			uint32_t covered = 0;
+			uint32_t previousRow = 0;
+			features = BoardFeatures();
+
+			for (int row = batch.highestRow - 1; row >= 0; --row) {
+				uint32_t cells = batch.rows[row][lane];
+				uint32_t coveredAbove = covered;
+				covered |= cells;
+				uint32_t empty = ~cells & full;
+
+				features.aggregateHeight += (int16_t)CountBits(covered);
+				features.holes += (int16_t)CountBits(empty & coveredAbove);
+				features.bumpiness += (int16_t)CountBits((covered ^ (covered >> 1)) & pairs);
+				features.columnTransitions += (int16_t)CountBits(cells ^ previousRow);
+
+				if (covered != 0) {
+					features.rowTransitions += (int16_t)(CountBits((cells ^ (cells >> 1)) & pairs) + (empty & 1) + ((empty & rightWall) != 0 ? 1 : 0));
+				}
+
+				uint32_t wells = empty & ~coveredAbove & ((cells << 1) | 1) & ((cells >> 1) | rightWall);
+				features.wellCells += (int16_t)CountBits(wells);
+
+				if (empty != 0 && (empty & (empty - 1)) == 0 && (empty & coveredAbove) == 0) {
+					features.clearableLines++;
+				}
+
+				previousRow = cells;
+			}
+
+			features.columnTransitions += (int16_t)CountBits(~(uint32_t)batch.rows[0][lane] & full);
+			features.linesCleared = batch.linesCleared[lane];
+		}
+	}
+
+	const char* GetEvaluatorInstructionSet() {
+#if TETRIS_EVALUATOR_AVX2
+		return "avx2";
+#elif TETRIS_EVALUATOR_SSE2
+		return "sse2";
+#else
+		return "scalar";
+#endif
+	}
+
+	void EvaluateBatches(const BoardBatch* batches, int numBatches, BoardFeatures* features) {
+#if TETRIS_EVALUATOR_AVX2 || TETRIS_EVALUATOR_SSE2
+		for (int i = 0; i < numBatches; ++i) {
+			for (int lane = 0; lane < BoardBatch::Size; lane += SimdOps::Lanes) {
+				EvaluateLanesSimd(batches[i], lane, features + i * BoardBatch::Size + lane);
+			}
+		}
+#else
+		EvaluateBatchesScalar(batches, numBatches, features);
+#endif
+	}
+
+	void EvaluateBatchesScalar(const BoardBatch* batches, int numBatches, BoardFeatures* features) {
+		for (int i = 0; i < numBatches; ++i) {
+			for (int lane = 0; lane < BoardBatch::Size; ++lane) {
+				EvaluateLaneScalar(batches[i], lane, features[i * BoardBatch::Size + lane]);
+			}
+		}
+	}
+
+	float ScoreFeatures(const BoardFeatures& features, const EvaluatorWeights& weights) {
+		return weights.aggregateHeight * features.aggregateHeight
+			+ weights.holes * features.holes
+			+ weights.bumpiness * features.bumpiness
+			+ weights.rowTransitions * features.rowTransitions
+			+ weights.columnTransitions * features.columnTransitions
+			+ weights.wellCells * features.wellCells
+			+ weights.clearableLines * features.clearableLines
+			+ weights.linesCleared * features.linesCleared;
+	}
+
+	void ScoreBatches(const BoardBatch* batches, int numBatches, const EvaluatorWeights& weights, float* scores) {
+		//evaluate 1 batch at a time so the features stay on the stack and in cache
+		BoardFeatures features[BoardBatch::Size];
+
+		for (int i = 0; i < numBatches; ++i) {
+			EvaluateBatches(&batches[i], 1, features);
+
+			for (int lane = 0; lane < BoardBatch::Size; ++lane) {
+				scores[i * BoardBatch::Size + lane] = ScoreFeatures(features[lane], weights);
+			}
+		}
+	}
+}
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "TetrisBoard.h"
+
+namespace TetrisCore
+{
+	//features of a board used to score it, all counted in cells
+	struct BoardFeatures
+	{
+		//sum of the heights of every column
+		int16_t aggregateHeight;
+
+		//empty cells with a block somewhere above them in the same column
+		int16_t holes;
+
+		//sum of the height differences between neighbouring columns
+		int16_t bumpiness;
+
+		//changes between empty and filled cells along each row up to the top of the stack, counting the walls as filled
+		int16_t rowTransitions;
+
+		//changes between empty and filled cells up each column, counting the floor as filled
+		int16_t columnTransitions;
+
+		//empty cells open to the top with a block or wall on both sides (i.e., the inside of wells)
+		int16_t wellCells;
+
+		//rows missing a single block with nothing above the gap, so they can be cleared by dropping a tetromino in
+		int16_t clearableLines;
+
+		//rows cleared by the placement that made the board
+		int16_t linesCleared;
+	};
+
+	//how much each feature adds to the score of a board (higher scores are better)
+	//the defaults are Yiyuan Lee's weights, the same as EvaluateBoard, with the extra features turned off
+	struct EvaluatorWeights
+	{
+		float aggregateHeight = -0.510066f;
+		float holes = -0.35663f;
+		float bumpiness = -0.184483f;
+		float rowTransitions = 0.f;
+		float columnTransitions = 0.f;
+		float wellCells = 0.f;
+		float clearableLines = 0.f;
+		float linesCleared = 0.760666f;
+	};
+
+	//a batch of boards with the same amount of columns, stored row by row with one 16 bit lane per board
+	//so every board in the batch can be evaluated at once, using 1 SIMD register (AVX2) or 2 (SSE2) per row
+	struct alignas(32) BoardBatch
+	{
+		static constexpr int Size = 16;
+
+		//row masks of every board, indexed by [row][board]
+		uint16_t rows[Board::MaxRows][Size];
+
+		//rows cleared by the placement that made each board
+		uint8_t linesCleared[Size];
+
+		//amount of boards added to the batch. Unused lanes are empty boards
+		int numBoards;
+
+		int numColumns;
+
+		//row above the highest block of any board in the batch, so empty rows at the top are skipped
+		int highestRow;
+
+		//empties the batch for boards with the given amount of columns
+		void Clear(int columns);
+
+		//copies the board into the next lane. Returns the lane, or -1 if the batch is full
+		int Add(const Board& board, int rowsCleared);
+	};
+
+	//name of the instruction set the evaluator was built for (avx2, sse2 or scalar)
+	const char* GetEvaluatorInstructionSet();
+
+	//counts the features of every board in the batches using SIMD where the build allows it
+	//features must have room for numBatches * BoardBatch::Size boards, including the unused lanes
+	void EvaluateBatches(const BoardBatch* batches, int numBatches, BoardFeatures* features);
+
+	//counts the same features one board at a time without SIMD, for CPUs without SSE2 and for checking the SIMD results
+	void EvaluateBatchesScalar(const BoardBatch* batches, int numBatches, BoardFeatures* features);
+
+	//scores a board from its features
+	float ScoreFeatures(const BoardFeatures& features, const EvaluatorWeights& weights);
+
+	//counts the features of every board in the batches and scores them. scores must have room for numBatches * BoardBatch::Size boards
+	void ScoreBatches(const BoardBatch* batches, int numBatches, const EvaluatorWeights& weights, float* scores);
+}
@@ -0,0 +1,530 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TetrisGame.h"
+#include "TetrisBits.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace TetrisCore
+{
+	Game::Game()
+	{
+		Init(GameConfig());
+	}
+
+	void Game::Init(const GameConfig& newConfig) {
+		config = newConfig;
+		state.board.Init(config.columns);
+		state.randomizer.Seed(config.seed, config.stream);
+
+		//initialisation of important variables
+		state.piece = Piece{ PieceType::J, 0, config.spawnColumn, config.spawnRow };
+		state.ghost = state.piece;
+		state.lastLock = LockResult();
+		state.stats = GameStats();
+		state.events = 0;
+		state.stepCount = 0;
+		state.stepAccumulator = 0.0;
+		state.gravityProgress = 0;
+		state.lockSteps = 0;
+
+		//convert the timings into whole steps
+		config.stepsPerSecond = std::max(1, config.stepsPerSecond);
+		lockDelaySteps = SecondsToSteps(config.lockDelay, config.stepsPerSecond);
+		autoShiftSteps = std::max(0, SecondsToSteps(config.autoShiftDelay, config.stepsPerSecond));
+		autoRepeatSteps = std::max(0, SecondsToSteps(config.autoRepeatRate, config.stepsPerSecond));
+
+		state.shiftSteps = 0;
+		state.horizontalInput = 0;
+		state.score = 0;
+		state.level = std::max(1, config.startLevel);
+		state.linesCleared = 0;
+		state.softDrop = false;
+		state.recentlyRotated = false;
+		state.tSpin = false;
+		state.miniTSpin = false;
+		state.largeOffset = false;
+		state.difficultMovePerformed = false;
+		state.scoreMultiplier = 1.f;
+		state.needsSpawn = true;
+		state.gameOver = false;
+
+		//precompute the gravity of every level so levelling up or releasing soft drop is a table lookup, then set initial gravity
+		BuildGravityTable();
+		softDropGravity = SecondsPerRowToGravity(config.softDropSpeed);
+		state.gravity = GetLevelGravity();
+	}
+
+	void Game::Spawn(PieceType type) {
+		if (state.gameOver) {
+			return;
+		}
+
+		SetPiece(Piece{ type, 0, config.spawnColumn, config.spawnRow });
+
+		//if the new tetromino spawns inside the stack then the playfield has overflowed
+		if (!Fits(state.piece)) {
+			state.gameOver = true;
+			state.events |= EventGameOver;
+		}
+	}
+
+	void Game::SpawnNext() {
+		Spawn(state.randomizer.Next());
+	}
+
+	void Game::SetPiece(const Piece& newPiece) {
+		state.piece = newPiece;
+		state.needsSpawn = false;
+		state.gravityProgress = 0;
+		state.lockSteps = 0;
+		state.recentlyRotated = false;
+		state.tSpin = false;
+		state.miniTSpin = false;
+		state.largeOffset = false;
+		UpdateGhost();
+		state.events |= EventPieceMoved;
+	}
+
+	void Game::LoadPosition(const Board& newBoard, const Piece& newPiece) {
+		state.board = newBoard;
+		SetPiece(newPiece);
+	}
+
+	void Game::Tick(float deltaTime) {
+		//if game over, exit as the tetromino should no longer be functional
+		if (state.gameOver) {
+			return;
+		}
+
+		const double stepTime = 1.0 / (double)config.stepsPerSecond;
+		state.stepAccumulator += std::min(std::max(deltaTime, 0.f), config.maxFrameTime);
+
+		//run whole steps only, so the game plays the same at any frame rate
+		while (state.stepAccumulator >= stepTime) {
+			//a tetromino locked and the next one hasn't spawned yet, so keep the remaining time for it
+			if (state.gameOver || state.needsSpawn) {
+				return;
+			}
+
+			Step();
+			state.stepAccumulator -= stepTime;
+		}
+	}
+
+	void Game::Step() {
+		//if game over or waiting for a new tetromino, exit as the tetromino should no longer be functional
+		if (state.gameOver || state.needsSpawn) {
+			return;
+		}
+
+		//increase timers by 1 step
+		state.stepCount++;
+
+		//if 10 lines have been cleared, increase the level (and gravity)
+		if (state.linesCleared >= 10) {
+			state.linesCleared = 0;
+			state.level++;
+			if (!state.softDrop) {
+				state.gravity = GetLevelGravity();
+			}
+			state.events |= EventLevelChanged;
+		}
+
+		bool moved = false;
+
+		//the press already moved the tetromino once, so it only moves on its own once the direction has been held for the auto shift delay
+		if (state.horizontalInput != 0 && ++state.shiftSteps >= autoShiftSteps) {
+			//instant auto repeat moves as far as the tetromino can go every step, otherwise 1 column every autoRepeatSteps
+			int maxMoves = autoRepeatSteps == 0 ? config.columns : 1;
+			for (int i = 0; i < maxMoves && Shift(state.horizontalInput); ++i) {
+			}
+
+			state.shiftSteps = autoShiftSteps - autoRepeatSteps;
+		}
+
+		//the ghost is already at the landing position, so the room left to fall is the distance to it
+		int dropDistance = state.piece.y - state.ghost.y;
+
+		if (dropDistance > 0) {
+			//the tetromino is in the air, so fall by the gravity, which can be several rows per step
+			state.gravityProgress += state.gravity;
+			int rowsToDrop = std::min((int)(state.gravityProgress >> GravityShift), dropDistance);
+			state.gravityProgress &= (1u << GravityShift) - 1;
+
+			if (rowsToDrop > 0) {
+				state.piece = state.piece.Moved(0, -rowsToDrop);
+				moved = true;
+				state.lockSteps = 0;
+
+				//if movement was soft dropped, increase score by 1 per row
+				if (state.softDrop) {
+					AddScore(rowsToDrop);
+				}
+			}
+		}
+
+		//the tetromino is grounded when it is resting on the ground or on the stack
+		if (state.piece.y == state.ghost.y) {
+			state.gravityProgress = 0;
+
+			//if landed for longer than lock delay, check it hasn't landed above the playfield
+			if (++state.lockSteps > lockDelaySteps) {
+				if (IsOverflowing()) {
+					state.gameOver = true;
+					state.events |= EventGameOver;
+					return;
+				}
+
+				//then lock the tetromino and ensure gravity is reset to standard speed if soft dropped
+				Lock();
+				SetSoftDrop(false);
+				return;
+			}
+		}
+
+		if (moved) {
+			state.events |= EventPieceMoved;
+
+			//last move was a drop/sideways movement, so T spins no longer count
+			state.recentlyRotated = false;
+			state.tSpin = false;
+			state.miniTSpin = false;
+		}
+	}
+
+	void Game::ApplyInput(InputType type, int value) {
+		switch (type) {
+		case InputType::Horizontal:
+			SetHorizontalInput(value);
+			break;
+		case InputType::SoftDrop:
+			SetSoftDrop(value != 0);
+			break;
+		case InputType::Rotate:
+			Rotate(value);
+			break;
+		case InputType::HardDrop:
+			HardDrop();
+			break;
+		default:
+			break;
+		}
+	}
+
+	void Game::SetHorizontalInput(int direction) {
+		int newDirection = direction < 0 ? -1 : (direction > 0 ? 1 : 0);
+		if (newDirection == state.horizontalInput) {
+			return;
+		}
+
+		//a new direction starts its own auto shift delay, as does pressing the same one again after letting go
+		state.horizontalInput = newDirection;
+		state.shiftSteps = 0;
+
+		//every press moves straight away, so a tap between steps is never lost
+		if (newDirection != 0 && !state.gameOver && !state.needsSpawn) {
+			Shift(newDirection);
+		}
+	}
+
+	void Game::SetSoftDrop(bool enabled) {
+		//soft drop uses a very fast drop speed, otherwise reset drop speed to current speed based on level
+		state.softDrop = enabled;
+		state.gravity = enabled ? softDropGravity : GetLevelGravity();
+	}
+
+	bool Game::Rotate(int direction) {
+		//if game over, disable controls by returning
+		if (state.gameOver || state.needsSpawn) {
+			return false;
+		}
+
+		Piece rotated = state.piece.Rotated(direction);
+		Cell cells[4];
+		rotated.GetCells(cells);
+
+		//the unshifted rotation is tested first, followed by each SRS wall kick in order
+		const Cell* kicks = WallKicks[GetKickClass(state.piece.type)][GetKickTransition(state.piece.rotation, direction)];
+		const Cell candidates[5] = { { 0, 0 }, kicks[0], kicks[1], kicks[2], kicks[3] };
+
+		//test every candidate against the board at once and take the first one that fits
+		uint32_t fitting = state.board.FindFittingOffsets(cells, candidates, 5);
+
+		//no wall kick was possible, so block the rotation
+		if (fitting == 0) {
+			return false;
+		}
+
+		int candidate = CountTrailingZeros(fitting);
+		rotated = rotated.Moved(candidates[candidate].x, candidates[candidate].y);
+
+		//if final offset was used, then it was a large wall kick, making player eligable for T spin
+		bool kickedToLargeOffset = candidate == 4;
+
+		state.piece = rotated;
+		state.largeOffset = kickedToLargeOffset;
+		UpdateGhost();
+		state.tSpin = false;
+		state.miniTSpin = false;
+
+		//check for a t spin if a T tetromino
+		if (state.piece.type == PieceType::T) {
+			CheckForTSpin();
+		}
+
+		//set bool to true in case of T spin/mini T spin
+		state.recentlyRotated = true;
+		state.events |= EventPieceMoved;
+		return true;
+	}
+
+	void Game::HardDrop() {
+		if (state.gameOver || state.needsSpawn) {
+			return;
+		}
+
+		//move tetromino to its landed position (i.e., the ghost) and lock it
+		int distanceToDrop = state.piece.y - state.ghost.y;
+		state.piece = state.ghost;
+		Lock();
+
+		//increase score based on rows moved multipled by 2
+		AddScore(2 * distanceToDrop);
+	}
+
+	bool Game::Shift(int direction) {
+		//move sideways unless blocked by a wall or landed block
+		Piece shifted = state.piece.Moved(direction, 0);
+		if (!Fits(shifted)) {
+			return false;
+		}
+
+		state.piece = shifted;
+		UpdateGhost();
+		state.events |= EventPieceMoved;
+
+		//last move was a sideways movement, so T spins no longer count
+		state.recentlyRotated = false;
+		state.tSpin = false;
+		state.miniTSpin = false;
+		return true;
+	}
+
+	int Game::GetDropDistance() const {
+		Cell cells[4];
+		state.piece.GetCells(cells);
+		return state.board.GetDropDistance(cells);
+	}
+
+	void Game::UpdateGhost() {
+		state.ghost = state.piece.Moved(0, -GetDropDistance());
+		state.events |= EventGhostMoved;
+	}
+
+	bool Game::IsOverflowing() const {
+		Cell cells[4];
+		state.piece.GetCells(cells);
+
+		//check for a game over using the first block that is resting on a landed block
+		for (int i = 0; i < 4; ++i) {
+			if (state.board.IsOccupied(cells[i].x, cells[i].y - 1)) {
+				return cells[i].y > config.overflowRow;
+			}
+		}
+
+		return false;
+	}
+
+	bool Game::HasInstantGravity() const {
+		return GetLevelGravity() >= ((uint32_t)config.spawnRow << GravityShift);
+	}
+
+	void Game::RestoreState(const GameState& snapshot, uint32_t restoredEvents) {
+		state = snapshot;
+
+		//the events in the snapshot were for whatever was shown when it was saved, not for what is shown now
+		state.events = restoredEvents;
+	}
+
+	uint32_t Game::TakeEvents() {
+		uint32_t takenEvents = state.events;
+		state.events = 0;
+		return takenEvents;
+	}
+
+	bool Game::Fits(const Piece& testPiece) const {
+		Cell cells[4];
+		testPiece.GetCells(cells);
+		return !state.board.Collides(cells);
+	}
+
+	void Game::Lock() {
+		state.piece.GetCells(state.lastLock.cells);
+		state.lastLock.type = state.piece.type;
+
+		//add the blocks to the playfield and clear any rows they filled
+		state.board.LockCells(state.lastLock.cells, (uint8_t)state.piece.type);
+		state.lastLock.clearedRows = state.board.FindFullRows(state.lastLock.cells);
+		state.lastLock.rowsCleared = CountBits(state.lastLock.clearedRows);
+
+		if (state.lastLock.clearedRows != 0) {
+			state.board.RemoveRows(state.lastLock.clearedRows);
+			state.linesCleared += state.lastLock.rowsCleared;
+			state.events |= EventLinesCleared;
+		}
+
+		//keep totals of the game
+		state.stats.pieces++;
+		state.stats.lines += state.lastLock.rowsCleared;
+		state.stats.tetrises += state.lastLock.rowsCleared >= 4 ? 1 : 0;
+		if (state.piece.type == PieceType::T) {
+			state.stats.tSpins += state.tSpin ? 1 : 0;
+			state.stats.miniTSpins += state.miniTSpin ? 1 : 0;
+		}
+
+		ScoreLock();
+
+		state.needsSpawn = true;
+		state.events |= EventPieceLocked;
+	}
+
+	void Game::ScoreLock() {
+		bool tBlock = state.piece.type == PieceType::T;
+
+		//if no lines were cleared
+		if (state.lastLock.rowsCleared < 1) {
+			//but it is a T tetromino, score the T spin (100 * level for mini T spin, 400 * level for T spin)
+			if (tBlock && state.miniTSpin) {
+				AddScore(100 * state.level);
+			}
+			else if (tBlock && state.tSpin) {
+				AddScore(400 * state.level);
+			}
+			return;
+		}
+
+		//base score of the move if it was a difficult move (i.e., tetris or T spin), otherwise 0
+		int difficultScore = 0;
+
+		switch (state.lastLock.rowsCleared) {
+		case 1:
+			if (tBlock && state.miniTSpin) {
+				difficultScore = 200;
+			}
+			else if (tBlock && state.tSpin) {
+				difficultScore = 800;
+			}
+			break;
+		case 2:
+			if (tBlock && state.miniTSpin) {
+				difficultScore = 400;
+			}
+			else if (tBlock && state.tSpin) {
+				difficultScore = 1200;
+			}
+			break;
+		case 3:
+			if (tBlock && state.tSpin) {
+				difficultScore = 1600;
+			}
+			break;
+		default:
+			//4 lines is a tetris
+			difficultScore = 800;
+			break;
+		}
+
+		if (difficultScore > 0) {
+			//if another difficult move was performed before this move, set multiplier to 1.5
+			if (state.difficultMovePerformed) {
+				state.scoreMultiplier = 1.5f;
+			}
+
+			//score is the base value multiplied by the current level and by the score multiplier
+			AddScore((int)((float)difficultScore * (float)state.level * state.scoreMultiplier));
+
+			//make player eligable for multiplier if they perform another difficult move next
+			state.difficultMovePerformed = true;
+			return;
+		}
+
+		//otherwise, break the difficult move streak and reset multiplier
+		state.difficultMovePerformed = false;
+		state.scoreMultiplier = 1.f;
+
+		//and update score by a base value of 100, 300 or 500 multiplied by level
+		static const int lineScores[4] = { 0, 100, 300, 500 };
+		AddScore(lineScores[state.lastLock.rowsCleared] * state.level);
+	}
+
+	void Game::CheckForTSpin() {
+		Cell cells[4];
+		state.piece.GetCells(cells);
+		const Cell& origin = cells[0];
+
+		//get the cells diagonally above and below the T tetromino origin (i.e., block 1 position) as a 4 bit mask
+		//bit 0 = above left, bit 1 = above right, bit 2 = below right, bit 3 = below left
+		int corners = 0;
+		corners |= state.board.IsOccupied(origin.x - 1, origin.y + 1) ? 1 : 0;
+		corners |= state.board.IsOccupied(origin.x + 1, origin.y + 1) ? 2 : 0;
+		corners |= state.board.IsOccupied(origin.x + 1, origin.y - 1) ? 4 : 0;
+		corners |= state.board.IsOccupied(origin.x - 1, origin.y - 1) ? 8 : 0;
+
+		//the 2 corners in front of the tetromino rotate around the mask with the rotation position
+		//(i.e., 0 = above left and right, R = above and below right, 2 = below left and right, L = above and below left)
+		int frontCorners = ((3 << state.piece.rotation) | (3 >> (4 - state.piece.rotation))) & 15;
+		int backCorners = ~frontCorners & 15;
+
+		if ((corners & frontCorners) == frontCorners && (corners & backCorners) != 0) {
+			//if 2 blocks are in front and at least 1 is behind, it is a T spin
+			state.tSpin = true;
+		}
+		else if ((corners & backCorners) == backCorners && (corners & frontCorners) != 0) {
+			//if 2 blocks are behind and 1 is in front, it is still a T spin if it wall kicked by a large offset, otherwise it is a mini T spin
+			if (state.largeOffset) {
+				state.tSpin = true;
+			}
+			else {
+				state.miniTSpin = true;
+			}
+		}
+	}
+
+	void Game::AddScore(int scoreIncrease) {
+		if (scoreIncrease == 0) {
+			return;
+		}
+
+		state.score += scoreIncrease;
+		state.events |= EventScoreChanged;
+	}
+
+	void Game::BuildGravityTable() {
+		for (int i = 0; i < MaxGravityLevel; ++i) {
+			float tableLevel = (float)(i + 1);
+			gravityTable[i] = SecondsPerRowToGravity(std::pow(0.8f - ((tableLevel - 1.f) * 0.007f), tableLevel - 1.f));
+		}
+	}
+
+	uint32_t Game::SecondsPerRowToGravity(float secondsPerRow) const {
+		uint32_t maxGravity = (uint32_t)std::max(1, config.maxGravity) << GravityShift;
+		if (secondsPerRow <= 0.f) {
+			return maxGravity;
+		}
+
+		//rows per step = 1 / (seconds per row * steps per second)
+		double rowsPerStep = 1.0 / ((double)secondsPerRow * (double)config.stepsPerSecond);
+		return (uint32_t)std::min((double)maxGravity, std::round(rowsPerStep * (double)(1u << GravityShift)));
+	}
+
+	int SecondsToSteps(float seconds, int stepsPerSecond) {
+		return (int)std::lround(seconds * (float)stepsPerSecond);
+	}
+
+	uint32_t Game::GetLevelGravity() const {
+		return gravityTable[std::min(std::max(state.level, 1), MaxGravityLevel) - 1];
+	}
+}
@@ -0,0 +1,348 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "TetrisBoard.h"
+#include "TetrisPiece.h"
+#include "TetrisRandomizer.h"
+
+#include <type_traits>
+
+namespace TetrisCore
+{
+	//things that happened during a call into the game, so whatever is displaying the game knows what to update
+	enum GameEvent : uint32_t
+	{
+		EventPieceMoved = 1 << 0,
+		EventPieceLocked = 1 << 1,
+		EventLinesCleared = 1 << 2,
+		EventScoreChanged = 1 << 3,
+		EventLevelChanged = 1 << 4,
+		EventGameOver = 1 << 5,
+		EventGhostMoved = 1 << 6,
+
+		//the whole state was replaced by RestoreState, so everything shown needs redrawing
+		EventStateRestored = 1 << 7,
+	};
+
+	//inputs the player can give the game. Every input goes through Game::ApplyInput so games can be recorded and replayed
+	enum class InputType : uint8_t
+	{
+		//value = direction held (-1 = left, 0 = none, 1 = right)
+		Horizontal,
+
+		//value = 1 to start soft dropping, 0 to stop
+		SoftDrop,
+
+		//value = 1 for clockwise, -1 for anti-clockwise
+		Rotate,
+
+		HardDrop,
+		Count
+	};
+
+	//settings of the playfield and timings of the game
+	struct GameConfig
+	{
+		//amount of columns between the walls
+		int columns = 10;
+
+		//column and row block 1 of a new tetromino spawns at
+		int spawnColumn = 5;
+		int spawnRow = 20;
+
+		//highest row a block can be on when it collides with the stack without ending the game
+		int overflowRow = 19;
+
+		//seconds a tetromino can sit on the ground before it locks
+		float lockDelay = 0.5f;
+
+		//seconds between each drop while soft dropping
+		float softDropSpeed = 0.01f;
+
+		//seconds a direction has to be held before the tetromino starts moving on its own (delayed auto shift)
+		//the first move always happens as soon as the direction is pressed, however briefly it is held
+		float autoShiftDelay = 0.167f;
+
+		//seconds between each move once the tetromino is moving on its own (auto repeat rate), 0 = straight to the wall
+		float autoRepeatRate = 0.033f;
+
+		//seed and stream of the tetromino randomizer. The same seed and stream always give the same tetrominoes
+		uint64_t seed = 0;
+		uint64_t stream = 0;
+
+		//amount of fixed simulation steps per second. Timings above are rounded to whole steps
+		int stepsPerSecond = 60;
+
+		//most rows the tetromino can fall in one step (20 = 20G, i.e., instantly to the bottom of the playfield)
+		int maxGravity = 20;
+
+		//longest frame that is simulated, so a long hitch doesn't freeze the game while it catches up
+		float maxFrameTime = 0.25f;
+
+		//level the game starts at, e.g., to play (or soak test the AI) at high gravity straight away
+		int startLevel = 1;
+	};
+
+	//converts a timing in seconds into the nearest whole amount of fixed steps
+	int SecondsToSteps(float seconds, int stepsPerSecond);
+
+	//highest level with its own gravity. Later levels use the same gravity as this one
+	static const int MaxGravityLevel = 30;
+
+	//gravity is stored as rows per step in 16.16 fixed point, so fractions of a row carry over between steps
+	static const int GravityShift = 16;
+
+	//details of the last tetromino that locked
+	struct LockResult
+	{
+		//cells the blocks locked on, before any lines were cleared
+		Cell cells[4];
+
+		PieceType type;
+
+		//bitmask (bit = row) of the rows cleared by the lock
+		uint64_t clearedRows;
+
+		//amount of rows cleared by the lock
+		int rowsCleared;
+	};
+
+	//totals for a whole game, used for balance testing
+	struct GameStats
+	{
+		//amount of tetrominoes locked
+		int pieces = 0;
+
+		//amount of rows cleared
+		int lines = 0;
+
+		//amount of locks that cleared 4 rows
+		int tetrises = 0;
+
+		//amount of locks that were T spins or mini T spins, whether or not they cleared rows
+		int tSpins = 0;
+		int miniTSpins = 0;
+	};
+
+	//everything about a game that changes during play. Trivially copyable, so a snapshot is a single copy of about 1.3KB
+	//and restoring it puts the game back exactly, e.g. for undo, rollback or searching ahead from the real game
+	//settings and anything worked out from them (e.g., the gravity of each level) aren't included, so it must be restored into a game with the same config
+	struct GameState
+	{
+		Board board;
+
+		//decides which tetromino spawns next
+		PieceRandomizer randomizer;
+
+		//the falling tetromino
+		Piece piece;
+
+		//the falling tetromino moved to where it would land. Falling doesn't change this, so it is cached until the tetromino moves sideways or rotates
+		Piece ghost;
+
+		LockResult lastLock;
+
+		GameStats stats;
+
+		//events waiting to be taken by TakeEvents
+		uint32_t events;
+
+		//amount of steps run since the game started, used to time inputs in replays
+		uint64_t stepCount;
+
+		//time left over from the last Tick that wasn't long enough for a whole step
+		double stepAccumulator;
+
+		//rows per step the tetromino currently falls at (16.16 fixed point). Increases in later levels
+		uint32_t gravity;
+
+		//fraction of a row the tetromino has fallen since it last moved down a whole row (16.16 fixed point)
+		uint32_t gravityProgress;
+
+		//steps since the tetromino landed or last moved down
+		int lockSteps;
+
+		//steps the current direction has been held for, wound back after each auto repeat move so the next one comes autoRepeatSteps later
+		int shiftSteps;
+
+		//direction the player is holding
+		int horizontalInput;
+
+		//current player's score
+		int score;
+
+		//current level that the player is at, affects the drop speed
+		int level;
+
+		//lines cleared since the last level up
+		int linesCleared;
+
+		//if true, will increase drop speed to soft drop speed
+		bool softDrop;
+
+		//reports if last move before locking tetromino was a rotation
+		bool recentlyRotated;
+
+		//if true, player has performed a T spin
+		bool tSpin;
+
+		//if true, player has performed a mini T spin
+		bool miniTSpin;
+
+		//if true, when rotated, T block has wall kicked to a large offset (i.e., offset 4 in wall kick array)
+		bool largeOffset;
+
+		//checks if player performed a difficult move when block was landed (i.e., tetris, mini T Spin/T spin single, mini T spin/T spin double or T spin triple)
+		bool difficultMovePerformed;
+
+		//multiplies score earnt by multiplier. Used for back-to-back difficult moves
+		float scoreMultiplier;
+
+		//true once a tetromino has locked until the next one spawns
+		bool needsSpawn;
+
+		bool gameOver;
+	};
+
+	static_assert(std::is_trivially_copyable<GameState>::value, "GameState must stay trivially copyable so snapshots are a single copy");
+
+	//the rules of the game: gravity, locking, rotation and wall kicks, line clears, T spins and scoring
+	class Game
+	{
+	public:
+		Game();
+
+		//starts a new game with the given settings
+		void Init(const GameConfig& newConfig);
+
+		//spawns a new tetromino of the given type at the spawn point
+		void Spawn(PieceType type);
+
+		//spawns the next tetromino from the randomizer
+		void SpawnNext();
+
+		//replaces the falling tetromino, e.g. to set up a puzzle or a benchmark
+		void SetPiece(const Piece& newPiece);
+
+		//replaces the landed blocks and the falling tetromino
+		void LoadPosition(const Board& newBoard, const Piece& newPiece);
+
+		//runs as many fixed steps as fit in deltaTime seconds, carrying the remainder over to the next call
+		void Tick(float deltaTime);
+
+		//advances gravity, sideways movement and lock delay by exactly 1 fixed step
+		void Step();
+
+		//passes a player input to the matching function below
+		void ApplyInput(InputType type, int value);
+
+		//sets the direction the player is holding (-1 = left, 0 = none, 1 = right). Pressing a new direction moves the tetromino straight away,
+		//then it moves on its own once the direction has been held for the auto shift delay
+		void SetHorizontalInput(int direction);
+
+		//starts or stops soft dropping
+		void SetSoftDrop(bool enabled);
+
+		//rotates the tetromino clockwise (direction = 1) or anti-clockwise (direction = -1), wall kicking if needed. Returns false if it couldn't rotate
+		bool Rotate(int direction);
+
+		//drops the tetromino as far as it can go and locks it
+		void HardDrop();
+
+		//gets the amount of rows the tetromino can fall before it lands
+		int GetDropDistance() const;
+
+		//returns true if the current level's gravity drops a tetromino from the spawn point to the ground in a single step (i.e., 20G)
+		bool HasInstantGravity() const;
+
+		//gets the Zobrist hash of the landed blocks, the falling tetromino and the preview. The board part is kept up to date as blocks lock and rows clear
+		uint64_t GetHash() const { return state.board.GetHash() ^ state.piece.GetHash() ^ state.randomizer.GetHash(); }
+
+		//copies the whole state of the game into the snapshot
+		void SaveState(GameState& snapshot) const { snapshot = state; }
+
+		//puts the game back to a snapshot saved from a game with the same config. Any events not yet taken are replaced by restoredEvents,
+		//e.g. the events that led up to the snapshot when showing a game simulated elsewhere
+		void RestoreState(const GameState& snapshot, uint32_t restoredEvents = EventStateRestored);
+
+		//returns the events that happened since the last call and clears them
+		uint32_t TakeEvents();
+
+		//gets the cells of the falling tetromino
+		void GetPieceCells(Cell cells[4]) const { state.piece.GetCells(cells); }
+
+		//gets the cells the falling tetromino would land on if hard dropped
+		void GetGhostCells(Cell cells[4]) const { state.ghost.GetCells(cells); }
+
+		const Board& GetBoard() const { return state.board; }
+		const Piece& GetPiece() const { return state.piece; }
+		const Piece& GetGhost() const { return state.ghost; }
+		const PieceRandomizer& GetRandomizer() const { return state.randomizer; }
+		const LockResult& GetLastLock() const { return state.lastLock; }
+		const GameStats& GetStats() const { return state.stats; }
+		const GameConfig& GetConfig() const { return config; }
+		int GetHorizontalInput() const { return state.horizontalInput; }
+		bool IsSoftDropping() const { return state.softDrop; }
+		uint64_t GetStepCount() const { return state.stepCount; }
+		int GetScore() const { return state.score; }
+		int GetLevel() const { return state.level; }
+		int GetLinesCleared() const { return state.linesCleared; }
+		bool IsGameOver() const { return state.gameOver; }
+
+		//returns true once a tetromino has locked and a new one needs to be spawned
+		bool NeedsSpawn() const { return state.needsSpawn; }
+
+	private:
+		//returns true if the tetromino fits in the playfield without overlapping landed blocks
+		bool Fits(const Piece& testPiece) const;
+
+		//moves the ghost to where the tetromino would land. Only needed when a sideways move, rotation or spawn changes where that is
+		void UpdateGhost();
+
+		//moves the tetromino 1 column left (-1) or right (1) if nothing is in the way. Returns false if it couldn't move
+		bool Shift(int direction);
+
+		//returns true if the tetromino is resting on the stack above the overflow row
+		bool IsOverflowing() const;
+
+		//adds the tetromino to the board, clears any full rows and scores the move
+		void Lock();
+
+		//adds the score for the lines cleared (or T spin performed) by the last lock
+		void ScoreLock();
+
+		//checks if player performed a t-spin after rotation
+		void CheckForTSpin();
+
+		//increases the score
+		void AddScore(int scoreIncrease);
+
+		//fills the gravity table for every level, based on tetris algorithm: seconds per row = (0.8 - (level - 1) * 0.007)^(level - 1)
+		void BuildGravityTable();
+
+		//converts seconds per row into rows per step, capped at the max gravity
+		uint32_t SecondsPerRowToGravity(float secondsPerRow) const;
+
+		//gets the gravity of the current level from the gravity table
+		uint32_t GetLevelGravity() const;
+
+		GameConfig config;
+
+		//gravity of each level (16.16 fixed point), indexed by level - 1
+		uint32_t gravityTable[MaxGravityLevel];
+
+		//gravity while soft dropping (16.16 fixed point)
+		uint32_t softDropGravity;
+
+		//steps the tetromino can sit on the ground before it locks
+		int lockDelaySteps;
+
+		//steps a direction is held before auto repeat starts, and between each auto repeat move (0 = straight to the wall)
+		int autoShiftSteps;
+		int autoRepeatSteps;
+
+		//everything that changes during play, kept together so it can be saved and restored in one copy
+		GameState state;
+	};
+}
@@ -0,0 +1,183 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TetrisLatency.h"
+#include "TetrisBits.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace TetrisCore
+{
+	LatencyAction GetLatencyAction(InputType type, int value) {
+		switch (type) {
+		case InputType::Horizontal:
+			//letting go of a direction doesn't move anything, so only presses are measured
+			return value != 0 ? LatencyAction::Move : LatencyAction::Count;
+		case InputType::Rotate:
+			return value > 0 ? LatencyAction::RotateClockwise : LatencyAction::RotateAntiClockwise;
+		case InputType::HardDrop:
+			return LatencyAction::HardDrop;
+		case InputType::SoftDrop:
+			return value != 0 ? LatencyAction::SoftDrop : LatencyAction::Count;
+		default:
+			return LatencyAction::Count;
+		}
+	}
+
+	const char* GetLatencyActionName(LatencyAction action) {
+		static const char* const names[NumLatencyActions] = { "move", "rotate_clockwise", "rotate_anti_clockwise", "hard_drop", "soft_drop" };
+		return action < LatencyAction::Count ? names[(int)action] : "none";
+	}
+
+	const char* GetLatencyStageName(LatencyStage stage) {
+		static const char* const names[NumLatencyStages] = { "input_to_applied", "applied_to_presented", "input_to_presented" };
+		return stage < LatencyStage::Count ? names[(int)stage] : "none";
+	}
+
+	LatencyHistogram::LatencyHistogram()
+	{
+		Clear();
+	}
+
+	int LatencyHistogram::GetBucket(uint64_t nanoseconds) {
+		//the first 16 buckets hold 1 value each, then each power of 2 is split into 16 buckets using the 4 bits under its highest bit
+		if (nanoseconds < (uint64_t)SubBuckets) {
+			return (int)nanoseconds;
+		}
+
+		int highestBit = HighestBit(nanoseconds);
+		if (highestBit >= MaxBit) {
+			return NumBuckets - 1;
+		}
+
+		int subBucket = (int)(nanoseconds >> (highestBit - SubBucketBits)) & (SubBuckets - 1);
+		return (highestBit - SubBucketBits + 1) * SubBuckets + subBucket;
+	}
+
+	uint64_t LatencyHistogram::GetBucketMin(int bucket) {
+		if (bucket < SubBuckets) {
+			return (uint64_t)bucket;
+		}
+
+		int shift = bucket / SubBuckets - 1;
+		return (uint64_t)(SubBuckets + bucket % SubBuckets) << shift;
+	}
+
+	uint64_t LatencyHistogram::GetBucketMax(int bucket) {
+		if (bucket < SubBuckets) {
+			return (uint64_t)bucket;
+		}
+
+		int shift = bucket / SubBuckets - 1;
+		return GetBucketMin(bucket) + ((uint64_t)1 << shift) - 1;
+	}
+
+	void LatencyHistogram::Record(uint64_t nanoseconds) {
+		counts[GetBucket(nanoseconds)]++;
+		count++;
+		max = std::max(max, nanoseconds);
+	}
+
+	void LatencyHistogram::Merge(const LatencyHistogram& other) {
+		for (int i = 0; i < NumBuckets; ++i) {
+			counts[i] += other.counts[i];
+		}
+
+		count += other.count;
+		max = std::max(max, other.max);
+	}
+
+	void LatencyHistogram::Clear() {
+		std::memset(counts, 0, sizeof(counts));
+		count = 0;
+		max = 0;
+	}
+
+	uint64_t LatencyHistogram::GetPercentile(double percentile) const {
+		if (count == 0) {
+			return 0;
+		}
+
+		//the rank of the latency wanted, counting from 1
+		uint64_t rank = std::max((uint64_t)1, (uint64_t)std::ceil(std::min(std::max(percentile, 0.0), 1.0) * (double)count));
+
+		uint64_t seen = 0;
+		for (int i = 0; i < NumBuckets; ++i) {
+			seen += counts[i];
+			if (seen >= rank) {
+				//the top of the bucket can be more than anything that was actually recorded
+				return std::min(GetBucketMax(i), max);
+			}
+		}
+
+		return max;
+	}
+
+	LatencyTracker::LatencyTracker()
+	{
+		Clear();
+	}
+
+	uint64_t LatencyTracker::Received(LatencyAction action, Clock::time_point time) {
+		uint64_t input = ++receivedCount;
+
+		//the slot is taken over even if its last input was never shown, as that one has been waiting for MaxPending inputs
+		PendingInput& entry = pending[input % MaxPending];
+		entry.input = input;
+		entry.action = action;
+		entry.applied = false;
+		entry.received = time;
+		entry.appliedTime = time;
+		return input;
+	}
+
+	void LatencyTracker::Applied(uint64_t input, Clock::time_point time) {
+		PendingInput& entry = pending[input % MaxPending];
+		if (entry.input != input || input <= presentedCount) {
+			return;
+		}
+
+		entry.applied = true;
+		entry.appliedTime = time;
+	}
+
+	void LatencyTracker::Presented(uint64_t lastInput, Clock::time_point time) {
+		lastInput = std::min(lastInput, receivedCount);
+
+		//inputs too old to still have a slot can't be measured
+		uint64_t first = std::max(presentedCount + 1, receivedCount >= (uint64_t)MaxPending ? receivedCount - (uint64_t)MaxPending + 1 : (uint64_t)1);
+
+		for (uint64_t input = first; input <= lastInput; ++input) {
+			const PendingInput& entry = pending[input % MaxPending];
+			if (entry.input != input || !entry.applied || entry.action == LatencyAction::Count) {
+				continue;
+			}
+
+			LatencyHistogram* actionHistograms = histograms[(int)entry.action];
+			actionHistograms[(int)LatencyStage::Applied].Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(entry.appliedTime - entry.received).count());
+			actionHistograms[(int)LatencyStage::Presented].Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(time - entry.appliedTime).count());
+			actionHistograms[(int)LatencyStage::Total].Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(time - entry.received).count());
+		}
+
+		presentedCount = std::max(presentedCount, lastInput);
+	}
+
+	void LatencyTracker::Clear() {
+		for (int i = 0; i < MaxPending; ++i) {
+			pending[i].input = 0;
+			pending[i].action = LatencyAction::Count;
+			pending[i].applied = false;
+		}
+
+		receivedCount = 0;
+		presentedCount = 0;
+
+		for (int action = 0; action < NumLatencyActions; ++action) {
+			for (int stage = 0; stage < NumLatencyStages; ++stage) {
+				histograms[action][stage].Clear();
+			}
+		}
+	}
+}
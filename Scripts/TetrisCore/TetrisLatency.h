@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "TetrisGame.h"
+
+#include <chrono>
+#include <cstdint>
+
+namespace TetrisCore
+{
+	//player inputs whose latency is measured. Count = an input that is passed on but not measured (e.g., letting go of a direction)
+	enum class LatencyAction : uint8_t
+	{
+		Move,
+		RotateClockwise,
+		RotateAntiClockwise,
+		HardDrop,
+		SoftDrop,
+		Count
+	};
+
+	//parts of an input's latency
+	enum class LatencyStage : uint8_t
+	{
+		//from the engine receiving the input to the game applying it
+		Applied,
+
+		//from the game applying the input to the result being submitted for rendering
+		Presented,
+
+		//from the engine receiving the input to the result being submitted for rendering
+		Total,
+		Count
+	};
+
+	static const int NumLatencyActions = (int)LatencyAction::Count;
+	static const int NumLatencyStages = (int)LatencyStage::Count;
+
+	//gets which action an input is measured as, or LatencyAction::Count if it isn't measured
+	LatencyAction GetLatencyAction(InputType type, int value);
+
+	//name of the action or stage, for reports
+	const char* GetLatencyActionName(LatencyAction action);
+	const char* GetLatencyStageName(LatencyStage stage);
+
+	//histogram of nanosecond latencies in fixed buckets, so recording never allocates
+	//buckets double in size every 16 buckets, so any value is within about 6% of the bucket it is counted in
+	class LatencyHistogram
+	{
+	public:
+		//16 buckets per power of 2, up to 2^40 ns (about 18 minutes). Longer latencies are counted in the last bucket
+		static constexpr int SubBucketBits = 4;
+		static constexpr int SubBuckets = 1 << SubBucketBits;
+		static constexpr int MaxBit = 40;
+		static constexpr int NumBuckets = (MaxBit - SubBucketBits + 1) * SubBuckets;
+
+		LatencyHistogram();
+
+		void Record(uint64_t nanoseconds);
+
+		//adds every latency of the other histogram to this one
+		void Merge(const LatencyHistogram& other);
+
+		void Clear();
+
+		//gets the latency that percentile (0 to 1) of the recorded latencies are at or under, as the top of its bucket. 0 if nothing is recorded
+		uint64_t GetPercentile(double percentile) const;
+
+		uint64_t GetCount() const { return count; }
+		uint64_t GetMax() const { return max; }
+		uint64_t GetBucketCount(int bucket) const { return counts[bucket]; }
+
+		//gets the smallest and largest latency counted in the bucket
+		static uint64_t GetBucketMin(int bucket);
+		static uint64_t GetBucketMax(int bucket);
+
+		static int GetBucket(uint64_t nanoseconds);
+
+	private:
+		uint32_t counts[NumBuckets];
+		uint64_t count;
+		uint64_t max;
+	};
+
+	//follows every input from the engine receiving it, to the game applying it, to its result being submitted for rendering,
+	//and keeps a histogram of each stage for each action. Inputs are numbered from 1 in the order they were received,
+	//which is also the order the game applies them in, so the simulation thread only has to send back the number of each input it applied
+	//only used by the thread showing the game
+	class LatencyTracker
+	{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		//most inputs that can be waiting to be shown at once. Any older ones still waiting are no longer measured
+		static constexpr int MaxPending = 256;
+
+		LatencyTracker();
+
+		//notes an input the engine has received and passed on to the game. Returns the input's number
+		uint64_t Received(LatencyAction action, Clock::time_point time);
+
+		//notes when the game applied the input with the given number
+		void Applied(uint64_t input, Clock::time_point time);
+
+		//notes that the results of every input up to and including the given number have been submitted for rendering.
+		//Inputs that were never applied (e.g., dropped) aren't measured
+		void Presented(uint64_t lastInput, Clock::time_point time);
+
+		//gets the number of the last input received
+		uint64_t GetReceivedCount() const { return receivedCount; }
+
+		const LatencyHistogram& GetHistogram(LatencyAction action, LatencyStage stage) const { return histograms[(int)action][(int)stage]; }
+
+		//forgets every pending input and recorded latency
+		void Clear();
+
+	private:
+		struct PendingInput
+		{
+			//number of the input, so a slot reused by a newer input isn't mistaken for this one
+			uint64_t input;
+			LatencyAction action;
+			bool applied;
+			Clock::time_point received;
+			Clock::time_point appliedTime;
+		};
+
+		PendingInput pending[MaxPending];
+		uint64_t receivedCount;
+
+		//number of the last input submitted for rendering
+		uint64_t presentedCount;
+
+		LatencyHistogram histograms[NumLatencyActions][NumLatencyStages];
+	};
+}
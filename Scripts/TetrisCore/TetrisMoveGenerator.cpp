@@ -0,0 +1,220 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TetrisMoveGenerator.h"
+#include "TetrisBits.h"
+
+#include <cstring>
+
+namespace TetrisCore
+{
+	MoveGenerator::MoveGenerator()
+	{
+		board = nullptr;
+		type = PieceType::T;
+		numNodes = 0;
+		numPlacements = 0;
+	}
+
+	int MoveGenerator::Generate(const Board& searchBoard, const Piece& start, bool instantGravity) {
+		board = &searchBoard;
+		type = start.type;
+		numNodes = 0;
+		numPlacements = 0;
+		std::memset(visited, 0, sizeof(visited));
+		std::memset(placementKeys, 0, sizeof(placementKeys));
+
+		BuildFitMasks(searchBoard, start.type);
+
+		if (!Fits(start.rotation, start.x, start.y)) {
+			board = nullptr;
+			return 0;
+		}
+
+		//breadth first, so the first time a position is found it has the shortest path
+		Visit(start.rotation, start.x, instantGravity ? DropRow(start.rotation, start.x, start.y) : start.y, MoveInput::Count, 0, -1);
+		const int kickClass = GetKickClass(type);
+
+		for (int head = 0; head < numNodes; ++head) {
+			const SearchNode node = nodes[head];
+			const int rotation = node.rotation;
+			const int x = node.x;
+			const int y = node.y;
+
+			if (Fits(rotation, x - 1, y)) {
+				Visit(rotation, x - 1, instantGravity ? DropRow(rotation, x - 1, y) : y, MoveInput::Left, 0, head);
+			}
+
+			if (Fits(rotation, x + 1, y)) {
+				Visit(rotation, x + 1, instantGravity ? DropRow(rotation, x + 1, y) : y, MoveInput::Right, 0, head);
+			}
+
+			//if it can't move down then it can lock here
+			if (Fits(rotation, x, y - 1)) {
+				Visit(rotation, x, y - 1, MoveInput::SoftDrop, 0, head);
+			}
+			else {
+				AddPlacement(head);
+			}
+
+			//test the unshifted rotation followed by each SRS wall kick in order, the same as Game::Rotate
+			for (int direction = -1; direction <= 1; direction += 2) {
+				const int rotated = (rotation + direction) & 3;
+				const Cell* kicks = WallKicks[kickClass][GetKickTransition(rotation, direction)];
+				const MoveInput move = direction > 0 ? MoveInput::RotateClockwise : MoveInput::RotateAntiClockwise;
+
+				for (int candidate = 0; candidate < 5; ++candidate) {
+					int kickedX = x + (candidate > 0 ? kicks[candidate - 1].x : 0);
+					int kickedY = y + (candidate > 0 ? kicks[candidate - 1].y : 0);
+
+					if (Fits(rotated, kickedX, kickedY)) {
+						//a tetromino that falls after rotating loses its T spin, the same as in the game
+						int droppedY = instantGravity ? DropRow(rotated, kickedX, kickedY) : kickedY;
+						Visit(rotated, kickedX, droppedY, move, candidate, head, droppedY != kickedY);
+						break;
+					}
+				}
+			}
+		}
+
+		board = nullptr;
+		return numPlacements;
+	}
+
+	int MoveGenerator::GetPath(int placementIndex, MoveInput* moves, int maxMoves, Piece* states) const {
+		//count the moves first so they can be written in order while walking back from the placement
+		int length = 0;
+		for (int index = placements[placementIndex].node; nodes[index].parent >= 0; index = nodes[index].parent) {
+			length++;
+		}
+
+		int position = length;
+		for (int index = placements[placementIndex].node; nodes[index].parent >= 0; index = nodes[index].parent) {
+			position--;
+			if (position < maxMoves) {
+				moves[position] = nodes[index].move;
+
+				if (states != nullptr) {
+					states[position] = Piece{ type, nodes[index].rotation, nodes[index].x, nodes[index].y };
+				}
+			}
+		}
+
+		return length;
+	}
+
+	void MoveGenerator::BuildFitMasks(const Board& searchBoard, PieceType pieceType) {
+		const uint32_t columns = (1u << searchBoard.GetNumColumns()) - 1;
+
+		for (int rotation = 0; rotation < 4; ++rotation) {
+			const Cell* offsets = PieceRotations.offsets[(int)pieceType][rotation];
+
+			for (int y = 0; y < MaxSearchRows; ++y) {
+				uint32_t mask = ~0u;
+
+				//block 1 can be at x if every block's cell is empty, so shift each row's empty cells back by the block's offset
+				for (int block = 0; block < 4 && mask != 0; ++block) {
+					int row = y + offsets[block].y;
+					uint32_t empty = row < 0 ? 0 : (~(uint32_t)searchBoard.GetRow(row) & columns) << ColumnBias;
+					int dx = offsets[block].x;
+					mask &= dx >= 0 ? empty >> dx : empty << -dx;
+				}
+
+				fitMasks[rotation][y] = mask;
+			}
+		}
+	}
+
+	bool MoveGenerator::Fits(int rotation, int x, int y) const {
+		int biasedX = x + ColumnBias;
+		if (y < 0 || y >= MaxSearchRows || biasedX < 0 || biasedX >= 32) {
+			return false;
+		}
+
+		return (fitMasks[rotation][y] & (1u << biasedX)) != 0;
+	}
+
+	int MoveGenerator::DropRow(int rotation, int x, int y) const {
+		while (Fits(rotation, x, y - 1)) {
+			y--;
+		}
+
+		return y;
+	}
+
+	void MoveGenerator::Visit(int rotation, int x, int y, MoveInput move, int kick, int parent, bool fell) {
+		//only T blocks care how they arrived, everything else shares 1 set of nodes
+		bool rotatedIn = type == PieceType::T && (move == MoveInput::RotateClockwise || move == MoveInput::RotateAntiClockwise) && !fell;
+		uint32_t bit = 1u << (x + ColumnBias);
+		uint32_t& visitedRow = visited[rotatedIn ? 1 : 0][rotation][y];
+
+		if ((visitedRow & bit) != 0 || numNodes >= MaxNodes) {
+			return;
+		}
+
+		visitedRow |= bit;
+
+		SearchNode& node = nodes[numNodes++];
+		node.rotation = (int8_t)rotation;
+		node.x = (int8_t)x;
+		node.y = (int8_t)y;
+		node.move = move;
+		node.kick = (uint8_t)kick;
+		node.fell = fell;
+		node.parent = (int16_t)parent;
+	}
+
+	void MoveGenerator::AddPlacement(int nodeIndex) {
+		if (numPlacements >= MaxPlacements) {
+			return;
+		}
+
+		const SearchNode& node = nodes[nodeIndex];
+		MovePlacement placement;
+		placement.piece = Piece{ type, node.rotation, node.x, node.y };
+		placement.lastMoveRotation = (node.move == MoveInput::RotateClockwise || node.move == MoveInput::RotateAntiClockwise) && !node.fell;
+		placement.largeKick = placement.lastMoveRotation && node.kick == 4;
+		placement.tSpinSlot = type == PieceType::T && placement.lastMoveRotation && IsTSpinSlot(placement.piece);
+		placement.node = nodeIndex;
+
+		//key the covered cells by their bottom left corner and a 4x4 shape mask, so rotations covering the same cells (e.g., any O block rotation) match
+		Cell cells[4];
+		placement.piece.GetCells(cells);
+
+		int minX = cells[0].x;
+		int minY = cells[0].y;
+		for (int i = 1; i < 4; ++i) {
+			minX = cells[i].x < minX ? cells[i].x : minX;
+			minY = cells[i].y < minY ? cells[i].y : minY;
+		}
+
+		uint32_t shape = 0;
+		for (int i = 0; i < 4; ++i) {
+			shape |= 1u << ((cells[i].y - minY) * 4 + (cells[i].x - minX));
+		}
+
+		//0 marks an empty slot, so keys start at 1
+		uint32_t key = 1 + (shape | (uint32_t)(minX + ColumnBias) << 16 | (uint32_t)minY << 21 | (placement.tSpinSlot ? 1u << 28 : 0u));
+
+		for (uint32_t slot = (key * 2654435761u) >> 21;; slot = (slot + 1) & (PlacementSetSize - 1)) {
+			if (placementKeys[slot] == key) {
+				return;
+			}
+
+			if (placementKeys[slot] == 0) {
+				placementKeys[slot] = key;
+				break;
+			}
+		}
+
+		placements[numPlacements++] = placement;
+	}
+
+	bool MoveGenerator::IsTSpinSlot(const Piece& piece) const {
+		int corners = 0;
+		corners += board->IsOccupied(piece.x - 1, piece.y + 1) ? 1 : 0;
+		corners += board->IsOccupied(piece.x + 1, piece.y + 1) ? 1 : 0;
+		corners += board->IsOccupied(piece.x + 1, piece.y - 1) ? 1 : 0;
+		corners += board->IsOccupied(piece.x - 1, piece.y - 1) ? 1 : 0;
+		return corners >= 3;
+	}
+}
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "TetrisPiece.h"
+
+namespace TetrisCore
+{
+	//single moves the move generator searches over, matching the player's controls
+	enum class MoveInput : uint8_t
+	{
+		Left,
+		Right,
+		SoftDrop,
+		RotateClockwise,
+		RotateAntiClockwise,
+		Count
+	};
+
+	//a position the tetromino can lock in
+	struct MovePlacement
+	{
+		//the tetromino resting in the position
+		Piece piece;
+
+		//true if the last move into the position was a rotation (needed for a T spin)
+		bool lastMoveRotation;
+
+		//true if this is a T block that rotated into a slot with at least 3 occupied corners (i.e., it will lock as a T spin or mini T spin)
+		bool tSpinSlot;
+
+		//true if that rotation used the last wall kick offset (which makes a T spin count as a full T spin)
+		bool largeKick;
+
+		//search node the position was found at, used to rebuild the moves that reach it
+		int node;
+	};
+
+	//finds every position a tetromino can reach and lock in, searching over sideways moves, soft drops and SRS rotations with wall kicks
+	//this includes tucks under overhangs and T spin slots. Positions are deduplicated by the cells they cover, except T blocks which
+	//keep a separate position for rotating into a T spin slot, as that scores differently. Reuse one generator, as it holds its search memory
+	class MoveGenerator
+	{
+	public:
+		//most positions that can be returned
+		static constexpr int MaxPlacements = 512;
+
+		MoveGenerator();
+
+		//searches every position reachable from the start (e.g., the spawn point) on the board. Returns the amount of lock positions found
+		//with instantGravity the tetromino falls as far as it can after every move (i.e., 20G), so there are no soft drops
+		int Generate(const Board& board, const Piece& start, bool instantGravity = false);
+
+		int GetNumPlacements() const { return numPlacements; }
+		const MovePlacement& GetPlacement(int index) const { return placements[index]; }
+
+		//gets the shortest list of moves from the start to a lock position (not including the final lock). Returns the amount of moves,
+		//only writing up to maxMoves of them. If states isn't null, it gets the position of the tetromino after each move
+		int GetPath(int placementIndex, MoveInput* moves, int maxMoves, Piece* states = nullptr) const;
+
+	private:
+		//columns are stored shifted right by this, so tetrominoes whose block 1 is left of the wall still fit in the masks
+		static constexpr int ColumnBias = 4;
+
+		//highest row (plus 1) block 1 is searched up to. Wall kicks can lift a tetromino above the rows stored in the board
+		static constexpr int MaxSearchRows = Board::MaxRows + 4;
+
+		//block 1 can be up to 2 columns outside either wall, so this many columns can be searched
+		static constexpr int MaxSearchColumns = Board::MaxColumns + ColumnBias;
+
+		//every rotation, column and row can be a node, twice for T blocks which are searched separately when arriving by rotation
+		static constexpr int MaxNodes = 2 * 4 * MaxSearchRows * MaxSearchColumns;
+
+		struct SearchNode
+		{
+			int8_t rotation;
+			int8_t x;
+			int8_t y;
+
+			//move taken from the parent node to get here
+			MoveInput move;
+
+			//wall kick candidate used if the move was a rotation (0 = no kick)
+			uint8_t kick;
+
+			//true if the tetromino fell after the move (instant gravity only)
+			bool fell;
+
+			//index of the node this was reached from, -1 for the start
+			int16_t parent;
+		};
+
+		//builds a mask (bit = column + ColumnBias) of where block 1 can be for every rotation and row without colliding
+		void BuildFitMasks(const Board& board, PieceType type);
+
+		//returns true if the tetromino fits at the rotation, column and row
+		bool Fits(int rotation, int x, int y) const;
+
+		//gets the lowest row the tetromino can fall to from the row, for instant gravity
+		int DropRow(int rotation, int x, int y) const;
+
+		//adds the node to the search if it hasn't been visited yet
+		void Visit(int rotation, int x, int y, MoveInput move, int kick, int parent, bool fell = false);
+
+		//records a lock position unless one covering the same cells has already been found
+		void AddPlacement(int nodeIndex);
+
+		//returns true if at least 3 of the cells diagonal to block 1 of the T block are occupied, the same test the game uses for T spins
+		bool IsTSpinSlot(const Piece& piece) const;
+
+		//board being searched, only valid during Generate
+		const Board* board;
+
+		PieceType type;
+
+		//where block 1 fits for every rotation and row
+		uint32_t fitMasks[4][MaxSearchRows];
+
+		//nodes already searched for every rotation and row (bit = column + ColumnBias). T blocks use the second set for nodes arrived at by rotation
+		uint32_t visited[2][4][MaxSearchRows];
+
+		//nodes in the order they were found, which is also the search queue
+		SearchNode nodes[MaxNodes];
+		int numNodes;
+
+		MovePlacement placements[MaxPlacements];
+		int numPlacements;
+
+		//open addressed set of the cells covered by each placement, so duplicate positions are skipped
+		static constexpr int PlacementSetSize = 2048;
+		uint32_t placementKeys[PlacementSetSize];
+	};
+}
@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "TetrisBoard.h"
+#include "TetrisZobrist.h"
+
+namespace TetrisCore
+{
+	//types of tetromino. The order matches the blockColours array set in the editor (i.e., blue = J, green = S, red = Z, yellow = O, light blue = I, orange = L, magenta = T)
+	enum class PieceType : uint8_t
+	{
+		J,
+		S,
+		Z,
+		O,
+		I,
+		L,
+		T,
+		Count
+	};
+
+	//amount of different tetrominoes
+	static const int NumPieceTypes = (int)PieceType::Count;
+
+	//offset of each block from block 1 for every rotation position of every tetromino, indexed by [piece type][rotation][block]
+	struct RotationTable
+	{
+		Cell offsets[NumPieceTypes][4][4];
+	};
+
+	//builds the rotation table at compile time by rotating the spawn layout of each tetromino around its rotation origin
+	constexpr RotationTable BuildRotationTable()
+	{
+		//offset of each block from block 1 when spawned (i.e., rotation 0), indexed by piece type
+		const Cell spawnOffsets[NumPieceTypes][4] = {
+			{ { 0, 0 }, { -1, 0 }, { -1, 1 }, { 1, 0 } },	//J
+			{ { 0, 0 }, { -1, 0 }, { 0, 1 }, { 1, 1 } },	//S
+			{ { 0, 0 }, { 1, 0 }, { 0, 1 }, { -1, 1 } },	//Z
+			{ { 0, 0 }, { 0, 1 }, { 1, 1 }, { 1, 0 } },		//O
+			{ { 0, 0 }, { -1, 0 }, { 1, 0 }, { 2, 0 } },	//I
+			{ { 0, 0 }, { -1, 0 }, { 1, 0 }, { 1, 1 } },	//L
+			{ { 0, 0 }, { -1, 0 }, { 0, 1 }, { 1, 0 } },	//T
+		};
+
+		//rotation origin relative to block 1 in half cells, as the I and O tetrominoes rotate around the corner between cells
+		const Cell originOffsetsX2[NumPieceTypes] = {
+			{ 0, 0 }, { 0, 0 }, { 0, 0 }, { 1, 1 }, { 1, -1 }, { 0, 0 }, { 0, 0 },
+		};
+
+		RotationTable table = {};
+		for (int type = 0; type < NumPieceTypes; ++type) {
+			const Cell& origin = originOffsetsX2[type];
+
+			for (int block = 0; block < 4; ++block) {
+				//work in half cells so the I and O origins stay whole numbers
+				int offsetX = spawnOffsets[type][block].x * 2 - origin.x;
+				int offsetY = spawnOffsets[type][block].y * 2 - origin.y;
+
+				for (int rotation = 0; rotation < 4; ++rotation) {
+					table.offsets[type][rotation][block] = { (offsetX + origin.x) / 2, (offsetY + origin.y) / 2 };
+
+					//rotate 90 degrees clockwise for the next rotation position
+					int rotatedX = offsetY;
+					offsetY = -offsetX;
+					offsetX = rotatedX;
+				}
+			}
+		}
+
+		return table;
+	}
+
+	//all rotation positions of every tetromino, so rotating is a table lookup rather than a calculation
+	inline constexpr RotationTable PieceRotations = BuildRotationTable();
+
+	static_assert(PieceRotations.offsets[(int)PieceType::T][1][2].x == 1 && PieceRotations.offsets[(int)PieceType::T][1][2].y == 0, "T block should point right in rotation R");
+	static_assert(PieceRotations.offsets[(int)PieceType::I][1][3].x == 1 && PieceRotations.offsets[(int)PieceType::I][1][3].y == -2, "I block should be vertical in the right column in rotation R");
+	static_assert(PieceRotations.offsets[(int)PieceType::O][2][0].x == 1 && PieceRotations.offsets[(int)PieceType::O][2][0].y == 1, "O block should rotate in place");
+
+	//wall kick class of a tetromino. The I block has its own offsets, the O block never needs to kick
+	inline int GetKickClass(PieceType type)
+	{
+		return type == PieceType::I ? 1 : 0;
+	}
+
+	//index of a rotation in the kick table, based on the rotation position before rotating and its direction
+	inline int GetKickTransition(int fromRotation, int direction)
+	{
+		return fromRotation * 2 + (direction < 0 ? 1 : 0);
+	}
+
+	//SRS wall kick offsets tested after a blocked rotation, indexed by [kick class][transition][test]
+	//transitions are 0->R, 0->L, R->2, R->0, 2->L, 2->R, L->0, L->2
+	inline constexpr Cell WallKicks[2][8][4] = {
+		//J, L, S, T and Z blocks
+		{
+			{ { -1, 0 }, { -1, 1 }, { 0, -2 }, { -1, -2 } },
+			{ { 1, 0 }, { 1, 1 }, { 0, -2 }, { 1, -2 } },
+			{ { 1, 0 }, { 1, -1 }, { 0, 2 }, { 1, 2 } },
+			{ { 1, 0 }, { 1, -1 }, { 0, 2 }, { 1, 2 } },
+			{ { 1, 0 }, { 1, 1 }, { 0, -2 }, { 1, -2 } },
+			{ { -1, 0 }, { -1, 1 }, { 0, -2 }, { -1, -2 } },
+			{ { -1, 0 }, { -1, -1 }, { 0, 2 }, { -1, 2 } },
+			{ { -1, 0 }, { -1, -1 }, { 0, 2 }, { -1, 2 } },
+		},
+		//I block
+		{
+			{ { -2, 0 }, { 1, 0 }, { -2, -1 }, { 1, 2 } },
+			{ { -1, 0 }, { 2, 0 }, { -1, 2 }, { 2, -1 } },
+			{ { -1, 0 }, { 2, 0 }, { -1, 2 }, { 2, -1 } },
+			{ { 2, 0 }, { -1, 0 }, { 2, 1 }, { -1, -2 } },
+			{ { 2, 0 }, { -1, 0 }, { 2, 1 }, { -1, -2 } },
+			{ { 1, 0 }, { -2, 0 }, { 1, -2 }, { -2, 1 } },
+			{ { 1, 0 }, { -2, 0 }, { 1, -2 }, { -2, 1 } },
+			{ { -2, 0 }, { 1, 0 }, { -2, -1 }, { 1, 2 } },
+		},
+	};
+
+	//a tetromino in the playfield
+	struct Piece
+	{
+		PieceType type;
+
+		//current rotation position (0 = 0 pos, 1 = R pos, 2 = 2 pos, 3 = L pos)
+		int rotation;
+
+		//column and row that block 1 spawns at. Moves with the tetromino but is not changed by rotations
+		int x;
+		int y;
+
+		//gets the cells of the 4 blocks, in the same order they were spawned in
+		void GetCells(Cell cells[4]) const
+		{
+			const Cell* offsets = PieceRotations.offsets[(int)type][rotation];
+			for (int i = 0; i < 4; ++i) {
+				cells[i].x = x + offsets[i].x;
+				cells[i].y = y + offsets[i].y;
+			}
+		}
+
+		//gets the Zobrist hash of the tetromino's type, rotation and position
+		uint64_t GetHash() const
+		{
+			return ZobristKeys.pieceTypes[(int)type] ^ ZobristKeys.pieceRotations[rotation]
+				^ ZobristKeys.pieceColumns[(x + 4) & (ZobristPieceColumns - 1)] ^ ZobristKeys.pieceRows[y & (ZobristPieceRows - 1)];
+		}
+
+		//gets a copy of the tetromino moved by dx columns and dy rows
+		Piece Moved(int dx, int dy) const
+		{
+			return Piece{ type, rotation, x + dx, y + dy };
+		}
+
+		//gets a copy of the tetromino rotated once clockwise (direction = 1) or anti-clockwise (direction = -1)
+		Piece Rotated(int direction) const
+		{
+			return Piece{ type, (rotation + direction + 4) & 3, x, y };
+		}
+	};
+}
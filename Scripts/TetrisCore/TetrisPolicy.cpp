@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TetrisPolicy.h"
+#include "TetrisAI.h"
+#include "TetrisBits.h"
+
+#include <cstdlib>
+
+namespace TetrisCore
+{
+	double EvaluateBoard(const Board& board, int rowsCleared) {
+		int previousHeight = 0;
+		int aggregateHeight = 0;
+		int holes = 0;
+		int bumpiness = 0;
+
+		for (int column = 0; column < board.GetNumColumns(); ++column) {
+			int height = board.GetColumnHeight(column);
+			aggregateHeight += height;
+
+			//every empty cell under the top of the column is a hole
+			holes += height - CountBits(board.GetColumnMask(column));
+
+			if (column > 0) {
+				bumpiness += std::abs(height - previousHeight);
+			}
+
+			previousHeight = height;
+		}
+
+		return -0.510066 * aggregateHeight + 0.760666 * rowsCleared - 0.35663 * holes - 0.184483 * bumpiness;
+	}
+
+	Placement ChooseGreedyPlacement(const Game& game) {
+		Placement best = { 0, game.GetPiece().x };
+		double bestScore = -1e30;
+
+		for (int rotations = 0; rotations < 4; ++rotations) {
+			Piece rotated = game.GetPiece();
+			for (int i = 0; i < rotations; ++i) {
+				rotated = rotated.Rotated(1);
+			}
+
+			for (int column = -2; column < game.GetBoard().GetNumColumns() + 2; ++column) {
+				Cell cells[4];
+				rotated.Moved(column - rotated.x, 0).GetCells(cells);
+				if (game.GetBoard().Collides(cells)) {
+					continue;
+				}
+
+				//drop the tetromino onto a copy of the board and clear any rows it fills
+				Board board = game.GetBoard();
+				int dropDistance = board.GetDropDistance(cells);
+				for (int i = 0; i < 4; ++i) {
+					cells[i].y -= dropDistance;
+				}
+
+				board.LockCells(cells, (uint8_t)rotated.type);
+				uint64_t fullRows = board.FindFullRows(cells);
+				board.RemoveRows(fullRows);
+
+				double score = EvaluateBoard(board, CountBits(fullRows));
+				if (score > bestScore) {
+					bestScore = score;
+					best = { rotations, column };
+				}
+			}
+		}
+
+		return best;
+	}
+
+	Placement ChooseRandomPlacement(const Game& game, uint64_t& randomState) {
+		//splitmix64, so every game can have its own random numbers without sharing state between threads
+		randomState += 0x9E3779B97F4A7C15ULL;
+		uint64_t random = randomState;
+		random = (random ^ (random >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		random = (random ^ (random >> 27)) * 0x94D049BB133111EBULL;
+		random ^= random >> 31;
+
+		return { (int)(random & 3), (int)((random >> 2) % (uint64_t)game.GetBoard().GetNumColumns()) };
+	}
+
+	Placement ChoosePlacement(PolicyType policy, const Game& game, uint64_t& randomState) {
+		return policy == PolicyType::Random ? ChooseRandomPlacement(game, randomState) : ChooseGreedyPlacement(game);
+	}
+
+	bool MoveToPlacement(Game& game, const Placement& placement) {
+		for (int i = 0; i < placement.rotations; ++i) {
+			game.ApplyInput(InputType::Rotate, 1);
+		}
+
+		//tap left or right once per step, as every press moves straight away, until the tetromino reaches the column or gets stuck against a wall or the stack
+		while (game.GetPiece().x != placement.column && !game.NeedsSpawn() && !game.IsGameOver()) {
+			int previousX = game.GetPiece().x;
+			game.ApplyInput(InputType::Horizontal, placement.column < previousX ? -1 : 1);
+			game.ApplyInput(InputType::Horizontal, 0);
+
+			if (game.GetPiece().x == previousX) {
+				break;
+			}
+
+			game.Step();
+		}
+
+		return !game.NeedsSpawn() && !game.IsGameOver();
+	}
+
+	void PlayGame(Game& game, PolicyType policy, int maxPieces, uint64_t randomState) {
+		if (policy == PolicyType::Lookahead) {
+			AIConfig config;
+			config.timeBudget = 0.0;
+
+			std::unique_ptr<LookaheadAI> ai(new LookaheadAI(nullptr, config));
+			PlayGameWithAI(game, *ai, maxPieces);
+			return;
+		}
+
+		for (int pieces = 0; pieces < maxPieces && !game.IsGameOver(); ++pieces) {
+			game.SpawnNext();
+			if (game.IsGameOver()) {
+				break;
+			}
+
+			if (MoveToPlacement(game, ChoosePlacement(policy, game, randomState))) {
+				game.ApplyInput(InputType::HardDrop, 0);
+			}
+
+			game.TakeEvents();
+		}
+	}
+}
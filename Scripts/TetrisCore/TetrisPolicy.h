@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "TetrisGame.h"
+
+namespace TetrisCore
+{
+	//ways a computer player can choose where to place each tetromino
+	enum class PolicyType : uint8_t
+	{
+		//place every tetromino where it leaves the best board
+		Greedy,
+
+		//place every tetromino in a random rotation and column
+		Random,
+
+		//place every tetromino using the beam search of LookaheadAI over the preview queue, driven through the controls
+		Lookahead,
+
+		Count
+	};
+
+	//where a computer player wants the falling tetromino to go
+	struct Placement
+	{
+		//amount of clockwise rotations from the current rotation
+		int rotations;
+
+		//column block 1 should end up in
+		int column;
+	};
+
+	//scores a board using the weights from Yiyuan Lee's tetris AI (higher is better)
+	double EvaluateBoard(const Board& board, int rowsCleared);
+
+	//tries every rotation and column for the falling tetromino and picks the one that leaves the best board
+	Placement ChooseGreedyPlacement(const Game& game);
+
+	//picks a random rotation and column. randomState is advanced, so each game should have its own
+	Placement ChooseRandomPlacement(const Game& game, uint64_t& randomState);
+
+	//picks a placement using the given policy. Lookahead moves the tetromino along a path rather than to a placement, so it picks the greedy placement here
+	Placement ChoosePlacement(PolicyType policy, const Game& game, uint64_t& randomState);
+
+	//rotates and moves the falling tetromino to the placement using the same inputs as a player, without dropping it
+	//returns false if gravity locked the tetromino on the way
+	bool MoveToPlacement(Game& game, const Placement& placement);
+
+	//plays the game with the policy until it tops out or maxPieces tetrominoes have been placed. The game must already be initialised
+	//Lookahead searches without a time limit on the calling thread, so the same game always plays out the same way
+	void PlayGame(Game& game, PolicyType policy, int maxPieces, uint64_t randomState);
+}
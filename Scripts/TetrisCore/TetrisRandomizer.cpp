@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TetrisRandomizer.h"
+
+namespace TetrisCore
+{
+	PieceRandomizer::PieceRandomizer()
+	{
+		Seed(0);
+	}
+
+	void PieceRandomizer::Seed(uint64_t seed, uint64_t stream) {
+		//standard PCG32 seeding, the stream must be odd
+		state = 0;
+		increment = (stream << 1) | 1;
+		NextRandom();
+		state += seed;
+		NextRandom();
+
+		head = 0;
+		count = 0;
+		AddBag();
+		UpdateHash();
+	}
+
+	PieceType PieceRandomizer::Next() {
+		PieceType next = queue[head];
+		head = (head + 1) % QueueSize;
+		count--;
+
+		//keep at least a full bag queued so the preview never runs out
+		if (count < PreviewSize) {
+			AddBag();
+		}
+
+		UpdateHash();
+		return next;
+	}
+
+	PieceType PieceRandomizer::Peek(int index) const {
+		return queue[(head + index) % QueueSize];
+	}
+
+	void PieceRandomizer::AddBag() {
+		PieceType bag[NumPieceTypes];
+		for (int i = 0; i < NumPieceTypes; ++i) {
+			bag[i] = (PieceType)i;
+		}
+
+		//Fisher-Yates shuffle
+		for (int i = NumPieceTypes - 1; i > 0; --i) {
+			int swapIndex = (int)NextRandom((uint32_t)i + 1);
+			PieceType swapped = bag[i];
+			bag[i] = bag[swapIndex];
+			bag[swapIndex] = swapped;
+		}
+
+		for (int i = 0; i < NumPieceTypes; ++i) {
+			queue[(head + count) % QueueSize] = bag[i];
+			count++;
+		}
+	}
+
+	void PieceRandomizer::UpdateHash() {
+		//every tetromino moves up one place in the preview when one is taken, so the whole preview is rehashed rather than updated
+		hash = ZobristKeys.queueCounts[count];
+		for (int i = 0; i < PreviewSize; ++i) {
+			hash ^= ZobristKeys.queue[i][(int)Peek(i)];
+		}
+	}
+
+	uint32_t PieceRandomizer::NextRandom() {
+		uint64_t oldState = state;
+		state = oldState * 6364136223846793005ULL + increment;
+
+		uint32_t xorShifted = (uint32_t)(((oldState >> 18) ^ oldState) >> 27);
+		uint32_t rotation = (uint32_t)(oldState >> 59);
+		return (xorShifted >> rotation) | (xorShifted << ((0u - rotation) & 31));
+	}
+
+	uint32_t PieceRandomizer::NextRandom(uint32_t bound) {
+		//scale a 32 bit number into the range with a multiply rather than a divide
+		return (uint32_t)(((uint64_t)NextRandom() * bound) >> 32);
+	}
+}
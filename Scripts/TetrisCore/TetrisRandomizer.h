@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "TetrisPiece.h"
+#include "TetrisZobrist.h"
+
+namespace TetrisCore
+{
+	//seeded 7 bag randomizer. Each bag holds every tetromino once in a shuffled order, so a tetromino never goes more than 12 spawns without appearing
+	//each instance has its own random state, so games with the same seed and stream always get the same tetrominoes
+	class PieceRandomizer
+	{
+	public:
+		//amount of upcoming tetrominoes that can always be peeked at
+		static constexpr int PreviewSize = NumPieceTypes;
+
+		PieceRandomizer();
+
+		//restarts the sequence. Different streams give different sequences from the same seed
+		void Seed(uint64_t seed, uint64_t stream = 0);
+
+		//takes the next tetromino from the queue
+		PieceType Next();
+
+		//gets an upcoming tetromino without taking it (0 = the next tetromino). Index must be less than PreviewSize
+		PieceType Peek(int index) const;
+
+		//gets the Zobrist hash of the preview and of how far through the bag the queue is, so 2 games hash the same if they will get the same upcoming tetrominoes
+		uint64_t GetHash() const { return hash; }
+
+	private:
+		//amount of tetrominoes the ring buffer can hold, enough for 2 full bags
+		static constexpr int QueueSize = 16;
+
+		//shuffles a new bag onto the end of the queue
+		void AddBag();
+
+		//rehashes the preview after the queue has changed
+		void UpdateHash();
+
+		//gets the next random number (PCG32)
+		uint32_t NextRandom();
+
+		//gets a random number from 0 to bound - 1
+		uint32_t NextRandom(uint32_t bound);
+
+		//upcoming tetrominoes, stored as a ring buffer so taking one doesn't shift the rest
+		PieceType queue[QueueSize];
+
+		//index of the next tetromino in the queue
+		int head;
+
+		//amount of tetrominoes in the queue
+		int count;
+
+		//Zobrist hash of the preview and the amount queued
+		uint64_t hash;
+
+		//random number generator state and stream
+		uint64_t state;
+		uint64_t increment;
+	};
+
+	static_assert(PieceRandomizer::PreviewSize <= ZobristQueueSize && NumPieceTypes <= ZobristPieceTypes, "Zobrist table doesn't cover the preview");
+}
@@ -0,0 +1,217 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TetrisReplay.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace TetrisCore
+{
+	ReplayWriter::ReplayWriter()
+	{
+		lastStep = 0;
+		recording = false;
+	}
+
+	void ReplayWriter::Begin(const GameConfig& config) {
+		data.reserve(ReservedBytes);
+		data.assign(ReplayMagic, ReplayMagic + 4);
+		WriteVarint(ReplayVersion);
+		WriteVarint(config.seed);
+		WriteVarint(config.stream);
+		WriteVarint((uint64_t)config.stepsPerSecond);
+
+		//stored in steps, the same as the game uses them, so playback doesn't depend on rounding the seconds again
+		WriteVarint((uint64_t)std::max(0, SecondsToSteps(config.autoShiftDelay, config.stepsPerSecond)));
+		WriteVarint((uint64_t)std::max(0, SecondsToSteps(config.autoRepeatRate, config.stepsPerSecond)));
+
+		lastStep = 0;
+		recording = true;
+	}
+
+	void ReplayWriter::Record(uint64_t step, InputType type, int value) {
+		if (!recording) {
+			return;
+		}
+
+		//all values fit in the top 4 bits once shifted up by 1 (i.e., -1 to 1 becomes 0 to 2)
+		data.push_back((uint8_t)((uint8_t)type | (uint8_t)((value + 1) << 4)));
+		WriteVarint(step - lastStep);
+		lastStep = step;
+	}
+
+	void ReplayWriter::Finish(uint64_t step) {
+		if (!recording) {
+			return;
+		}
+
+		Record(step, InputType::Count, 0);
+		recording = false;
+	}
+
+	void ReplayWriter::WriteVarint(uint64_t value) {
+		//most step gaps are under 128, so they only take 1 byte
+		while (value >= 0x80) {
+			data.push_back((uint8_t)(value | 0x80));
+			value >>= 7;
+		}
+
+		data.push_back((uint8_t)value);
+	}
+
+	ReplayReader::ReplayReader()
+	{
+		data = nullptr;
+		size = 0;
+		position = 0;
+		seed = 0;
+		stream = 0;
+		stepsPerSecond = 60;
+		autoShiftSteps = 0;
+		autoRepeatSteps = 0;
+		lastStep = 0;
+	}
+
+	bool ReplayReader::Open(const uint8_t* replayData, size_t replaySize) {
+		data = replayData;
+		size = replaySize;
+		position = 0;
+		lastStep = 0;
+
+		if (data == nullptr || size < 4 || std::memcmp(data, ReplayMagic, 4) != 0) {
+			return false;
+		}
+
+		position = 4;
+
+		uint64_t version;
+		if (!ReadVarint(version) || version != ReplayVersion) {
+			return false;
+		}
+
+		if (!ReadVarint(seed) || !ReadVarint(stream)) {
+			return false;
+		}
+
+		//inputs are timed in steps, so the replay has to be played at the rate and sideways timings it was recorded with
+		uint64_t rate;
+		uint64_t shiftSteps;
+		uint64_t repeatSteps;
+		if (!ReadVarint(rate) || rate == 0 || rate > 10000 || !ReadVarint(shiftSteps) || !ReadVarint(repeatSteps) || shiftSteps > rate * 10 || repeatSteps > rate * 10) {
+			return false;
+		}
+
+		stepsPerSecond = (int)rate;
+		autoShiftSteps = (int)shiftSteps;
+		autoRepeatSteps = (int)repeatSteps;
+		return true;
+	}
+
+	bool ReplayReader::Next(ReplayEvent& event) {
+		if (position >= size) {
+			return false;
+		}
+
+		uint8_t header = data[position++];
+		uint64_t stepDelta;
+		if (!ReadVarint(stepDelta)) {
+			return false;
+		}
+
+		event.type = (InputType)(header & 15);
+		event.value = (int)(header >> 4) - 1;
+		if (event.type > InputType::Count) {
+			return false;
+		}
+
+		lastStep += stepDelta;
+		event.step = lastStep;
+		return true;
+	}
+
+	bool ReplayReader::ReadVarint(uint64_t& value) {
+		value = 0;
+
+		for (int shift = 0; shift < 64; shift += 7) {
+			if (position >= size) {
+				return false;
+			}
+
+			uint8_t byte = data[position++];
+			value |= (uint64_t)(byte & 0x7F) << shift;
+
+			if ((byte & 0x80) == 0) {
+				return true;
+			}
+		}
+
+		//more than 10 bytes can't be a valid 64 bit number
+		return false;
+	}
+
+	ReplayPlayer::ReplayPlayer()
+	{
+		pending = ReplayEvent{ 0, InputType::Count, 0 };
+		finished = true;
+	}
+
+	bool ReplayPlayer::Start(Game& game, GameConfig config, const uint8_t* replayData, size_t replaySize) {
+		finished = true;
+		if (!reader.Open(replayData, replaySize)) {
+			return false;
+		}
+
+		config.seed = reader.GetSeed();
+		config.stream = reader.GetStream();
+		config.stepsPerSecond = reader.GetStepsPerSecond();
+		config.autoShiftDelay = (float)reader.GetAutoShiftSteps() / (float)config.stepsPerSecond;
+		config.autoRepeatRate = (float)reader.GetAutoRepeatSteps() / (float)config.stepsPerSecond;
+		game.Init(config);
+
+		//a replay with no inputs at all still needs an end marker
+		finished = !reader.Next(pending);
+		return !finished;
+	}
+
+	bool ReplayPlayer::Advance(Game& game, uint64_t targetStep) {
+		while (!finished && !game.IsGameOver()) {
+			//step the game up to the next input, or the target if that comes first
+			uint64_t stopStep = std::min(pending.step, targetStep);
+			while (game.GetStepCount() < stopStep && !game.IsGameOver()) {
+				//the recorded game always spawned the next tetromino straight after a lock, before anything else happened
+				if (game.NeedsSpawn()) {
+					game.SpawnNext();
+				}
+
+				game.Step();
+			}
+
+			if (game.GetStepCount() < pending.step || game.IsGameOver()) {
+				break;
+			}
+
+			if (game.NeedsSpawn()) {
+				game.SpawnNext();
+			}
+
+			if (pending.type == InputType::Count) {
+				finished = true;
+				break;
+			}
+
+			game.ApplyInput(pending.type, pending.value);
+
+			//a corrupt or cut off replay ends at the last input that could be read
+			if (!reader.Next(pending)) {
+				finished = true;
+			}
+		}
+
+		if (game.NeedsSpawn() && !game.IsGameOver()) {
+			game.SpawnNext();
+		}
+
+		return !finished && !game.IsGameOver();
+	}
+}
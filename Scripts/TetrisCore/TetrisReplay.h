@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "TetrisGame.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace TetrisCore
+{
+	//replay file layout. All numbers after the magic are varints (7 bits per byte, lowest bits first, top bit set if more bytes follow)
+	//	"TRPL", version, seed, stream, steps per second, auto shift delay and auto repeat rate (in steps)
+	//	then per input: 1 byte (input type in the low 4 bits, value + 1 in the high 4 bits), steps since the previous input
+	//	then an end marker (type = InputType::Count) with the steps until the recording stopped
+	static const uint8_t ReplayMagic[4] = { 'T', 'R', 'P', 'L' };
+
+	//versions before 3 moved sideways on a fixed repeat rather than with delayed auto shift, so they can't be played back the same
+	static const uint32_t ReplayVersion = 3;
+
+	//an input read from a replay. type = InputType::Count marks the end of the replay
+	struct ReplayEvent
+	{
+		uint64_t step;
+		InputType type;
+		int value;
+	};
+
+	//records the seed and inputs of a game
+	class ReplayWriter
+	{
+	public:
+		ReplayWriter();
+
+		//starts a new recording for a game using the seed, stream, fixed step rate and sideways timings of the given settings
+		void Begin(const GameConfig& config);
+
+		//adds an input, applied after the given amount of game steps
+		void Record(uint64_t step, InputType type, int value);
+
+		//marks the step the recording stopped at. Inputs recorded after this are ignored
+		void Finish(uint64_t step);
+
+		//stops recording without finishing, e.g. when the game is rewound and the inputs so far no longer replay it
+		void Discard() { recording = false; }
+
+		bool IsRecording() const { return recording; }
+
+		//gets the encoded replay
+		const std::vector<uint8_t>& GetData() const { return data; }
+
+	private:
+		//bytes reserved when a recording starts, enough for thousands of inputs so recording doesn't allocate during a game
+		static constexpr size_t ReservedBytes = 16 * 1024;
+
+		void WriteVarint(uint64_t value);
+
+		std::vector<uint8_t> data;
+
+		//step of the last input, as inputs are stored as the steps since the previous one
+		uint64_t lastStep;
+
+		bool recording;
+	};
+
+	//reads the seed and inputs of an encoded replay. The data must stay valid while it is being read
+	class ReplayReader
+	{
+	public:
+		ReplayReader();
+
+		//reads the header. Returns false if the data isn't a replay of a supported version
+		bool Open(const uint8_t* replayData, size_t replaySize);
+
+		//reads the next input. Returns false if there are no more or the data is corrupt
+		bool Next(ReplayEvent& event);
+
+		uint64_t GetSeed() const { return seed; }
+		uint64_t GetStream() const { return stream; }
+		int GetStepsPerSecond() const { return stepsPerSecond; }
+		int GetAutoShiftSteps() const { return autoShiftSteps; }
+		int GetAutoRepeatSteps() const { return autoRepeatSteps; }
+
+	private:
+		bool ReadVarint(uint64_t& value);
+
+		const uint8_t* data;
+		size_t size;
+
+		//amount of bytes read so far
+		size_t position;
+
+		uint64_t seed;
+		uint64_t stream;
+		int stepsPerSecond;
+		int autoShiftSteps;
+		int autoRepeatSteps;
+
+		//step of the last input read
+		uint64_t lastStep;
+	};
+
+	//plays a replay back into a game, spawning tetrominoes and stepping the game between inputs exactly as the recorded game did
+	class ReplayPlayer
+	{
+	public:
+		ReplayPlayer();
+
+		//starts a new game with the replay's seed, step rate and sideways timings and the given settings. Returns false if the data isn't a valid replay
+		bool Start(Game& game, GameConfig config, const uint8_t* replayData, size_t replaySize);
+
+		//plays the replay until the game has run targetStep steps, the replay ends or the game is over
+		//pass UINT64_MAX to play the whole replay as fast as possible. Returns false once there is nothing left to play
+		bool Advance(Game& game, uint64_t targetStep);
+
+		bool IsFinished() const { return finished; }
+
+	private:
+		ReplayReader reader;
+
+		//the next input to apply
+		ReplayEvent pending;
+
+		bool finished;
+	};
+}
@@ -0,0 +1,180 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TetrisSimulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace TetrisCore
+{
+	typedef std::chrono::steady_clock Clock;
+
+	SimulationThread::SimulationThread()
+		: recorder(nullptr), unsentEvents(0), frameUnsent(false), commandsApplied(0), skippedSteps(0), stopping(false)
+	{
+	}
+
+	SimulationThread::~SimulationThread()
+	{
+		Stop();
+	}
+
+	void SimulationThread::Start(const GameConfig& config, ReplayWriter* replayRecorder) {
+		Stop();
+
+		game.Init(config);
+		recorder = replayRecorder;
+		unsentEvents = 0;
+		frameUnsent = false;
+		commandsApplied = 0;
+		skippedSteps = 0;
+		stopping = false;
+
+		//spawn the first tetromino here so it is in the first frame, before the thread has run a step
+		SpawnIfNeeded();
+		SendFrame(false);
+
+		thread = std::thread(&SimulationThread::Run, this);
+	}
+
+	void SimulationThread::Stop() {
+		if (!thread.joinable()) {
+			return;
+		}
+
+		stopping.store(true, std::memory_order_release);
+		thread.join();
+	}
+
+	bool SimulationThread::PushInput(InputType type, int value) {
+		return commands.TryPush(SimulationCommand{ type, value, Clock::now() });
+	}
+
+	bool SimulationThread::TakeLatestFrame(SimulationFrame& frame) {
+		if (!frames.TryPop(frame)) {
+			return false;
+		}
+
+		//anything older than the newest frame is only kept for its events
+		uint32_t events = frame.state.events;
+		while (frames.TryPop(frame)) {
+			events |= frame.state.events;
+		}
+
+		frame.state.events = events;
+		return true;
+	}
+
+	bool SimulationThread::TakeAppliedInput(uint64_t lastInput, SimulationAppliedInput& applied) {
+		const SimulationAppliedInput* next = appliedInputs.Peek();
+		if (next == nullptr || next->input > lastInput) {
+			return false;
+		}
+
+		return appliedInputs.TryPop(applied);
+	}
+
+	void SimulationThread::Run() {
+		const int stepsPerSecond = game.GetConfig().stepsPerSecond;
+		const Clock::duration stepTime = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / (double)stepsPerSecond));
+
+		//most steps run in one go to catch up, the same limit as Game::Tick puts on a long frame
+		const int maxCatchUpSteps = std::max(1, (int)std::lround(game.GetConfig().maxFrameTime * (float)stepsPerSecond));
+
+		Clock::time_point nextStep = Clock::now() + stepTime;
+		while (!stopping.load(std::memory_order_acquire)) {
+			//nothing changes after game over, but the game over frame must still get through before the thread ends
+			if (game.IsGameOver()) {
+				SendFrame(false);
+				if (!frameUnsent) {
+					break;
+				}
+
+				std::this_thread::sleep_for(stepTime);
+				continue;
+			}
+
+			Clock::time_point now = Clock::now();
+			if (now < nextStep) {
+				std::this_thread::sleep_until(nextStep);
+				continue;
+			}
+
+			bool inputsApplied = false;
+			int stepsRun = 0;
+			while (nextStep <= now && stepsRun < maxCatchUpSteps && !game.IsGameOver()) {
+				inputsApplied |= ApplyInputs(nextStep);
+				SpawnIfNeeded();
+				game.Step();
+
+				//spawn straight after a lock so the new tetromino is in the same frame
+				SpawnIfNeeded();
+
+				nextStep += stepTime;
+				stepsRun++;
+			}
+
+			//if the thread was held up for too long, skip the missed steps rather than running a burst of them
+			if (nextStep <= now && !game.IsGameOver()) {
+				uint64_t missed = (uint64_t)((now - nextStep) / stepTime) + 1;
+				skippedSteps.fetch_add(missed, std::memory_order_relaxed);
+				nextStep += stepTime * (Clock::rep)missed;
+			}
+
+			SendFrame(inputsApplied);
+		}
+	}
+
+	bool SimulationThread::ApplyInputs(Clock::time_point stepTime) {
+		bool applied = false;
+
+		//when catching up, inputs pushed later than this step wait for the step they were pushed before
+		const SimulationCommand* next;
+		while ((next = commands.Peek()) != nullptr && next->time <= stepTime) {
+			SimulationCommand command = *next;
+			commands.TryPop(command);
+
+			//the replay player spawns before applying an input too, so the input lands on the same tetromino when replayed
+			SpawnIfNeeded();
+
+			if (recorder != nullptr) {
+				recorder->Record(game.GetStepCount(), command.type, command.value);
+			}
+
+			game.ApplyInput(command.type, command.value);
+			commandsApplied++;
+			applied = true;
+
+			//pushed before the frame showing the input, so whoever takes that frame can also take this
+			appliedInputs.TryPush(SimulationAppliedInput{ commandsApplied, Clock::now() });
+		}
+
+		return applied;
+	}
+
+	void SimulationThread::SpawnIfNeeded() {
+		if (game.NeedsSpawn() && !game.IsGameOver()) {
+			game.SpawnNext();
+		}
+	}
+
+	void SimulationThread::SendFrame(bool inputsApplied) {
+		unsentEvents |= game.TakeEvents();
+
+		//the sender waits for its inputs to show up, so a frame goes out after every input even if it changed nothing
+		if (unsentEvents == 0 && !inputsApplied && !frameUnsent) {
+			return;
+		}
+
+		game.SaveState(nextFrame.state);
+		nextFrame.state.events = unsentEvents;
+		nextFrame.commandsApplied = commandsApplied;
+
+		frameUnsent = !frames.TryPush(nextFrame);
+		if (!frameUnsent) {
+			unsentEvents = 0;
+		}
+	}
+}
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "TetrisGame.h"
+#include "TetrisReplay.h"
+#include "TetrisSpscQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace TetrisCore
+{
+	//an input sent to the simulation thread
+	struct SimulationCommand
+	{
+		InputType type;
+		int value;
+
+		//when the input was pushed, so it is applied before the first step due after it and not a whole catch up burst early or late
+		std::chrono::steady_clock::time_point time;
+	};
+
+	//when the simulation thread applied an input, sent back for latency measurement
+	struct SimulationAppliedInput
+	{
+		//inputs are numbered from 1 in the order they were pushed (and applied)
+		uint64_t input;
+		std::chrono::steady_clock::time_point time;
+	};
+
+	//the game as it was after a simulation step, sent back to be shown
+	struct SimulationFrame
+	{
+		//state.events holds every event since the last frame that was sent, so none are lost if the queue was full
+		GameState state;
+
+		//amount of commands applied since the simulation started, so the sender can tell when the game has caught up with its inputs
+		uint64_t commandsApplied;
+	};
+
+	//runs a game on its own thread at the fixed rate of its config, so hitches on the thread showing the game don't hold up gravity or lock delay
+	//inputs go in and frames come out through lock-free queues. Only one thread may push inputs and take frames (e.g., the game thread)
+	class SimulationThread
+	{
+	public:
+		static constexpr int CommandQueueSize = 256;
+
+		//frames are only sent when something changed, and whoever shows them only needs the newest, so a few is plenty
+		static constexpr int FrameQueueSize = 4;
+
+		SimulationThread();
+
+		//stops the thread if it is still running
+		~SimulationThread();
+
+		SimulationThread(const SimulationThread&) = delete;
+		SimulationThread& operator=(const SimulationThread&) = delete;
+
+		//starts a new game with the config and runs it on a new thread, spawning each tetromino as soon as the last one locks
+		//every input is recorded against the step it was applied at if a recorder is given. The recorder mustn't be touched until Stop returns
+		void Start(const GameConfig& config, ReplayWriter* replayRecorder = nullptr);
+
+		//stops the thread and waits for it. The game stays as it was, so it can be read with GetGame
+		void Stop();
+
+		bool IsRunning() const { return thread.joinable(); }
+
+		//queues an input to be applied before the next step due after now. Inputs are applied in the order they were pushed,
+		//so a press and release between 2 steps both still happen. Returns false if the queue is full and the input was dropped
+		bool PushInput(InputType type, int value);
+
+		//takes the newest frame the thread has sent, merging the events of any older frames into it. Returns false if there is no new frame
+		bool TakeLatestFrame(SimulationFrame& frame);
+
+		//takes the oldest applied input time if that input is at or before lastInput (e.g., the frame's commandsApplied),
+		//leaving inputs that aren't in the frame being shown yet for later. Returns false if there isn't one.
+		//Times that don't fit in the queue because they weren't taken are dropped
+		bool TakeAppliedInput(uint64_t lastInput, SimulationAppliedInput& applied);
+
+		//gets the game being simulated. Only safe to read while the thread isn't running
+		const Game& GetGame() const { return game; }
+
+		//amount of steps that were skipped because the thread was held up for longer than the config's maxFrameTime
+		uint64_t GetSkippedSteps() const { return skippedSteps.load(std::memory_order_relaxed); }
+
+	private:
+		//steps the game at a fixed rate until stopped or game over
+		void Run();
+
+		//applies every queued input pushed before the step due at stepTime, spawning the next tetromino first if one has locked. Returns true if there were any
+		bool ApplyInputs(std::chrono::steady_clock::time_point stepTime);
+
+		void SpawnIfNeeded();
+
+		//sends a frame if anything changed since the last one. A frame that doesn't fit in the queue is sent again with the next one's events
+		void SendFrame(bool inputsApplied);
+
+		Game game;
+
+		//records the inputs, if set
+		ReplayWriter* recorder;
+
+		SpscQueue<SimulationCommand, CommandQueueSize> commands;
+		SpscQueue<SimulationFrame, FrameQueueSize> frames;
+		SpscQueue<SimulationAppliedInput, CommandQueueSize> appliedInputs;
+
+		//frame being built by the simulation thread
+		SimulationFrame nextFrame;
+
+		//events that happened since the last frame that was sent
+		uint32_t unsentEvents;
+
+		//true if the last frame didn't fit in the queue
+		bool frameUnsent;
+
+		uint64_t commandsApplied;
+
+		std::atomic<uint64_t> skippedSteps;
+		std::atomic<bool> stopping;
+		std::thread thread;
+	};
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace TetrisCore
+{
+	//fixed size queue between exactly 2 threads, one pushing and one popping, without locks
+	//the 2 ends are on separate cache lines, and each end caches the other's position so it only reads the shared one when it looks full or empty
+	template<typename T, int Capacity>
+	class SpscQueue
+	{
+	public:
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of 2");
+
+		SpscQueue()
+			: head(0), cachedTail(0), tail(0), cachedHead(0)
+		{
+		}
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		//adds a copy of the item to the back. Returns false if the queue is full. Only call from the pushing thread
+		bool TryPush(const T& item) {
+			size_t currentTail = tail.load(std::memory_order_relaxed);
+			if (currentTail - cachedHead >= (size_t)Capacity) {
+				cachedHead = head.load(std::memory_order_acquire);
+				if (currentTail - cachedHead >= (size_t)Capacity) {
+					return false;
+				}
+			}
+
+			items[currentTail & (Capacity - 1)] = item;
+			tail.store(currentTail + 1, std::memory_order_release);
+			return true;
+		}
+
+		//gets the item at the front without taking it, or nullptr if the queue is empty. Only call from the popping thread
+		const T* Peek() {
+			size_t currentHead = head.load(std::memory_order_relaxed);
+			if (currentHead == cachedTail) {
+				cachedTail = tail.load(std::memory_order_acquire);
+				if (currentHead == cachedTail) {
+					return nullptr;
+				}
+			}
+
+			return &items[currentHead & (Capacity - 1)];
+		}
+
+		//takes the item at the front. Returns false if the queue is empty. Only call from the popping thread
+		bool TryPop(T& item) {
+			size_t currentHead = head.load(std::memory_order_relaxed);
+			if (currentHead == cachedTail) {
+				cachedTail = tail.load(std::memory_order_acquire);
+				if (currentHead == cachedTail) {
+					return false;
+				}
+			}
+
+			item = items[currentHead & (Capacity - 1)];
+			head.store(currentHead + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		//index of the next item to pop, and the popping thread's copy of the tail
+		alignas(64) std::atomic<size_t> head;
+		size_t cachedTail;
+
+		//index the next item is pushed to, and the pushing thread's copy of the head
+		alignas(64) std::atomic<size_t> tail;
+		size_t cachedHead;
+
+		alignas(64) T items[Capacity];
+	};
+}
@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TetrisThreadPool.h"
+
+#include <algorithm>
+
+namespace TetrisCore
+{
+	//index of the worker running on this thread, or -1 if this thread isn't a worker
+	static thread_local int currentWorker = -1;
+
+	//the pool this thread is a worker of, so a task submitted to a different pool isn't put on the wrong queue
+	static thread_local const ThreadPool* currentPool = nullptr;
+
+	ThreadPool::ThreadPool(int numThreads)
+		: queuedTasks(0), unfinishedTasks(0), nextQueue(0), stopping(false)
+	{
+		if (numThreads <= 0) {
+			numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+		}
+
+		for (int i = 0; i < numThreads; ++i) {
+			queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+		}
+
+		for (int i = 0; i < numThreads; ++i) {
+			threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		Wait();
+
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			stopping = true;
+		}
+		wakeCondition.notify_all();
+
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+
+	void ThreadPool::Submit(Task task) {
+		unfinishedTasks.fetch_add(1);
+
+		//tasks made by a task stay on the same worker, where the data they use is likely still in cache
+		int queueIndex = currentPool == this ? currentWorker : (int)(nextQueue.fetch_add(1) % (unsigned)queues.size());
+		{
+			std::lock_guard<std::mutex> lock(queues[queueIndex]->mutex);
+			queues[queueIndex]->tasks.push_back(std::move(task));
+		}
+
+		//counted under the wake mutex so a worker can't check for tasks and go to sleep in between
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			queuedTasks.fetch_add(1);
+		}
+		wakeCondition.notify_one();
+	}
+
+	void ThreadPool::Wait() {
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		doneCondition.wait(lock, [this]() { return unfinishedTasks.load() == 0; });
+	}
+
+	void ThreadPool::ParallelFor(int count, const std::function<void(int index, int slot)>& body) {
+		if (count <= 0) {
+			return;
+		}
+
+		//shared with the helper tasks, which may only start after this returns, so they find no indices left and exit
+		struct LoopState
+		{
+			std::function<void(int, int)> body;
+			std::atomic<int> nextIndex;
+			std::atomic<int> finished;
+			std::atomic<int> nextSlot;
+		};
+
+		std::shared_ptr<LoopState> loop = std::make_shared<LoopState>();
+		loop->body = body;
+		loop->nextIndex = 0;
+		loop->finished = 0;
+		loop->nextSlot = 1;
+
+		//takes indices until there are none left
+		auto runIndices = [count](LoopState& state, int slot) {
+			for (int index = state.nextIndex.fetch_add(1); index < count; index = state.nextIndex.fetch_add(1)) {
+				state.body(index, slot);
+				state.finished.fetch_add(1);
+			}
+		};
+
+		int helpers = std::min(count - 1, GetNumThreads());
+		for (int i = 0; i < helpers; ++i) {
+			Submit([loop, runIndices]() { runIndices(*loop, loop->nextSlot.fetch_add(1)); });
+		}
+
+		runIndices(*loop, 0);
+
+		//the last indices may still be running on helpers. They are already running, so yielding until they finish can't deadlock
+		while (loop->finished.load() < count) {
+			std::this_thread::yield();
+		}
+	}
+
+	void ThreadPool::WorkerLoop(int workerIndex) {
+		currentWorker = workerIndex;
+		currentPool = this;
+
+		while (true) {
+			Task task;
+			if (TakeTask(workerIndex, task)) {
+				queuedTasks.fetch_sub(1);
+				task();
+
+				//wake anything waiting for the pool to finish once the last task is done
+				if (unfinishedTasks.fetch_sub(1) == 1) {
+					std::lock_guard<std::mutex> lock(wakeMutex);
+					doneCondition.notify_all();
+				}
+				continue;
+			}
+
+			//nothing to do or steal, so sleep until a task is submitted
+			std::unique_lock<std::mutex> lock(wakeMutex);
+			wakeCondition.wait(lock, [this]() { return stopping || queuedTasks.load() > 0; });
+			if (stopping && queuedTasks.load() <= 0) {
+				return;
+			}
+		}
+	}
+
+	bool ThreadPool::TakeTask(int workerIndex, Task& task) {
+		//newest task from our own queue first
+		{
+			WorkerQueue& queue = *queues[workerIndex];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty()) {
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+				return true;
+			}
+		}
+
+		//then steal the oldest task from the other workers, starting with the next one along so workers don't all rob the same queue
+		int numQueues = (int)queues.size();
+		for (int offset = 1; offset < numQueues; ++offset) {
+			WorkerQueue& queue = *queues[(workerIndex + offset) % numQueues];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty()) {
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace TetrisCore
+{
+	//work stealing thread pool. Each worker has its own queue and takes the newest task from it, and when that is empty
+	//steals the oldest task from another worker, so workers rarely wait on each other
+	class ThreadPool
+	{
+	public:
+		typedef std::function<void()> Task;
+
+		//starts the worker threads. 0 = one per hardware thread
+		explicit ThreadPool(int numThreads = 0);
+
+		//finishes the queued tasks and stops the workers
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		//queues a task. Tasks submitted from a worker go on that worker's queue, others are spread across all queues
+		void Submit(Task task);
+
+		//blocks until every submitted task has finished
+		void Wait();
+
+		//runs body(index, slot) for every index from 0 to count - 1, returning once they have all finished
+		//the calling thread runs indices too, so this can be called from inside a task without waiting on itself
+		//slot is unique to each thread taking part (0 = the calling thread, up to GetNumThreads()), e.g. for per thread scratch memory
+		void ParallelFor(int count, const std::function<void(int index, int slot)>& body);
+
+		int GetNumThreads() const { return (int)threads.size(); }
+
+	private:
+		struct WorkerQueue
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		void WorkerLoop(int workerIndex);
+
+		//takes the newest task from the worker's own queue, otherwise steals the oldest task from another queue
+		bool TakeTask(int workerIndex, Task& task);
+
+		std::vector<std::unique_ptr<WorkerQueue>> queues;
+		std::vector<std::thread> threads;
+
+		//guards sleeping and waking the workers and Wait
+		std::mutex wakeMutex;
+		std::condition_variable wakeCondition;
+		std::condition_variable doneCondition;
+
+		//tasks sitting in a queue
+		std::atomic<int> queuedTasks;
+
+		//tasks submitted but not finished yet
+		std::atomic<int> unfinishedTasks;
+
+		//queue the next task from outside the pool goes on
+		std::atomic<unsigned> nextQueue;
+
+		bool stopping;
+	};
+}
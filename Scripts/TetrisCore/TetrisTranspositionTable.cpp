@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TetrisTranspositionTable.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace TetrisCore
+{
+	//marks an entry as used
+	static const uint64_t EntryUsed = (uint64_t)1 << 32;
+
+	TranspositionTable::TranspositionTable(int bits)
+	{
+		bits = std::max(1, std::min(bits, 28));
+		mask = ((uint64_t)1 << bits) - 1;
+		entries.reset(new Entry[(size_t)mask + 1]);
+		Clear();
+	}
+
+	void TranspositionTable::Clear() {
+		for (uint64_t i = 0; i <= mask; ++i) {
+			entries[i].check.store(0, std::memory_order_relaxed);
+			entries[i].data.store(0, std::memory_order_relaxed);
+		}
+
+		probes.store(0, std::memory_order_relaxed);
+		hits.store(0, std::memory_order_relaxed);
+		stores.store(0, std::memory_order_relaxed);
+	}
+
+	bool TranspositionTable::Probe(uint64_t key, float& score) const {
+		const Entry& entry = entries[key & mask];
+		uint64_t data = entry.data.load(std::memory_order_relaxed);
+		uint64_t check = entry.check.load(std::memory_order_relaxed);
+
+		if ((data & EntryUsed) == 0 || (check ^ data) != key) {
+			return false;
+		}
+
+		uint32_t scoreBits = (uint32_t)data;
+		std::memcpy(&score, &scoreBits, sizeof(score));
+		return true;
+	}
+
+	void TranspositionTable::Store(uint64_t key, float score) {
+		uint32_t scoreBits;
+		std::memcpy(&scoreBits, &score, sizeof(scoreBits));
+		uint64_t data = EntryUsed | scoreBits;
+
+		Entry& entry = entries[key & mask];
+		entry.data.store(data, std::memory_order_relaxed);
+		entry.check.store(key ^ data, std::memory_order_relaxed);
+	}
+
+	void TranspositionTable::AddStats(uint64_t newProbes, uint64_t newHits, uint64_t newStores) {
+		probes.fetch_add(newProbes, std::memory_order_relaxed);
+		hits.fetch_add(newHits, std::memory_order_relaxed);
+		stores.fetch_add(newStores, std::memory_order_relaxed);
+	}
+
+	TranspositionStats TranspositionTable::GetStats() const {
+		TranspositionStats stats;
+		stats.probes = probes.load(std::memory_order_relaxed);
+		stats.hits = hits.load(std::memory_order_relaxed);
+		stats.stores = stores.load(std::memory_order_relaxed);
+		return stats;
+	}
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace TetrisCore
+{
+	//totals of a transposition table since it was made or cleared
+	struct TranspositionStats
+	{
+		uint64_t probes;
+		uint64_t hits;
+		uint64_t stores;
+
+		//fraction of probes that found a score (0 if nothing was probed)
+		double GetHitRate() const { return probes > 0 ? (double)hits / (double)probes : 0.0; }
+	};
+
+	//fixed size cache of board scores keyed by Zobrist hash, shared by every thread of a search without locks
+	//each entry stores the key XORed with its data, so an entry torn by 2 threads writing at once no longer matches either key and reads as a miss
+	class TranspositionTable
+	{
+	public:
+		//makes a table of 2^bits entries (16 bytes each)
+		explicit TranspositionTable(int bits);
+
+		TranspositionTable(const TranspositionTable&) = delete;
+		TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+		//empties every entry and resets the stats
+		void Clear();
+
+		//gets the score stored for the key. Returns false if it isn't in the table
+		bool Probe(uint64_t key, float& score) const;
+
+		//stores the score for the key, replacing whatever was in its entry
+		void Store(uint64_t key, float score);
+
+		//adds to the stats. Threads count their own probes and add them in one go, so they don't fight over the counters on every probe
+		void AddStats(uint64_t probes, uint64_t hits, uint64_t stores);
+
+		TranspositionStats GetStats() const;
+
+		int GetNumEntries() const { return (int)(mask + 1); }
+
+	private:
+		struct alignas(16) Entry
+		{
+			//key ^ data
+			std::atomic<uint64_t> check;
+
+			//score bits in the low 32 bits, with bit 32 set once the entry is used so an empty entry never matches
+			std::atomic<uint64_t> data;
+		};
+
+		std::unique_ptr<Entry[]> entries;
+
+		//entries - 1, entries is a power of 2 so the low bits of the key pick the entry
+		uint64_t mask;
+
+		std::atomic<uint64_t> probes;
+		std::atomic<uint64_t> hits;
+		std::atomic<uint64_t> stores;
+	};
+}
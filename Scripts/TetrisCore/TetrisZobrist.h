@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cstdint>
+
+namespace TetrisCore
+{
+	//largest playfield, falling tetromino position and queue the Zobrist keys cover. Checked against the board and randomizer sizes where they are used
+	static constexpr int ZobristRows = 48;
+	static constexpr int ZobristColumns = 16;
+	static constexpr int ZobristPieceTypes = 7;
+	static constexpr int ZobristPieceColumns = 32;
+	static constexpr int ZobristPieceRows = 64;
+	static constexpr int ZobristQueueSize = 16;
+
+	//random keys XORed together to hash a game state. Adding or removing a block XORs its key in or out, so the hash is updated as the board changes
+	struct ZobristTable
+	{
+		//one key per cell of the board, indexed by [row][column]
+		uint64_t cells[ZobristRows][ZobristColumns];
+
+		//keys of the falling tetromino's type, rotation, column (+ 4, as block 1 can be left of the wall) and row. Both are powers of 2 so positions can be masked into range
+		uint64_t pieceTypes[ZobristPieceTypes];
+		uint64_t pieceRotations[4];
+		uint64_t pieceColumns[ZobristPieceColumns];
+		uint64_t pieceRows[ZobristPieceRows];
+
+		//keys of each upcoming tetromino in the preview, indexed by [position][type], and of the amount left in the queue (i.e., how far through the bag it is)
+		uint64_t queue[ZobristQueueSize][ZobristPieceTypes];
+		uint64_t queueCounts[ZobristQueueSize + 1];
+	};
+
+	//fills the table at compile time from a fixed splitmix64 sequence, so hashes are the same in every build and on every platform
+	constexpr ZobristTable BuildZobristTable()
+	{
+		ZobristTable table = {};
+		uint64_t state = 0x5A0B7157C0DEull;
+
+		auto next = [&state]() {
+			state += 0x9E3779B97F4A7C15ull;
+			uint64_t key = state;
+			key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+			key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+			return key ^ (key >> 31);
+		};
+
+		for (int row = 0; row < ZobristRows; ++row) {
+			for (int column = 0; column < ZobristColumns; ++column) {
+				table.cells[row][column] = next();
+			}
+		}
+
+		for (int i = 0; i < ZobristPieceTypes; ++i) {
+			table.pieceTypes[i] = next();
+		}
+		for (int i = 0; i < 4; ++i) {
+			table.pieceRotations[i] = next();
+		}
+		for (int i = 0; i < ZobristPieceColumns; ++i) {
+			table.pieceColumns[i] = next();
+		}
+		for (int i = 0; i < ZobristPieceRows; ++i) {
+			table.pieceRows[i] = next();
+		}
+
+		for (int position = 0; position < ZobristQueueSize; ++position) {
+			for (int type = 0; type < ZobristPieceTypes; ++type) {
+				table.queue[position][type] = next();
+			}
+		}
+		for (int i = 0; i <= ZobristQueueSize; ++i) {
+			table.queueCounts[i] = next();
+		}
+
+		return table;
+	}
+
+	inline constexpr ZobristTable ZobristKeys = BuildZobristTable();
+}
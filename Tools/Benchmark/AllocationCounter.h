@@ -0,0 +1,10 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+//replaces the global operator new for the whole program so benchmarks can count heap allocations
+namespace AllocationCounter
+{
+	//amount of heap allocations made since the program started
+	long long GetCount();
+}
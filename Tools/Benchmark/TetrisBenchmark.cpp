@@ -0,0 +1,240 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+//headless full game benchmark. Plays games through TetrisCore::Game using the same inputs as ATetrisBlock
+//(spawn, sideways moves, rotations and hard drops) and reports pieces/sec, line clears/sec and the time taken by each lock
+//
+//usage: TetrisBenchmark [--games N] [--pieces N] [--seed N] [--policy greedy|random] [--out file.json] [--fail-on-allocation]
+//with --fail-on-allocation the benchmark exits with an error if the game made any heap allocations while spawning, moving, rotating, locking or clearing
+
+#include "AllocationCounter.h"
+#include "TetrisCore/TetrisPolicy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace TetrisCore;
+
+typedef std::chrono::steady_clock Clock;
+
+namespace
+{
+	struct BenchmarkOptions
+	{
+		int games = 20;
+
+		//games are stopped after this many pieces, so a good policy doesn't run forever
+		int maxPieces = 10000;
+
+		uint64_t seed = 1;
+
+		//greedy = place every piece where it leaves the flattest stack, random = place every piece anywhere
+		std::string policy = "greedy";
+
+		std::string outputPath = "benchmark_results.json";
+
+		//if true, any heap allocation made by the game counts as a failure
+		bool failOnAllocation = false;
+	};
+
+	struct BenchmarkResults
+	{
+		long long pieces = 0;
+		long long lineClears = 0;
+		long long linesCleared = 0;
+		long long score = 0;
+
+		//seconds spent inside the game, not counting the policy deciding where to place pieces
+		double gameSeconds = 0.0;
+
+		double wallSeconds = 0.0;
+
+		//heap allocations made inside the game. Should always be 0 once a game has started
+		long long gameAllocations = 0;
+
+		//nanoseconds taken by each hard drop (i.e., lock, line clear and scoring)
+		std::vector<long long> lockTimes;
+	};
+
+	bool ParseOptions(int argc, char** argv, BenchmarkOptions& options) {
+		for (int i = 1; i < argc; ++i) {
+			const char* arg = argv[i];
+			const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+			if (std::strcmp(arg, "--fail-on-allocation") == 0) {
+				options.failOnAllocation = true;
+				continue;
+			}
+
+			if (value == nullptr) {
+				std::fprintf(stderr, "missing value for %s\n", arg);
+				return false;
+			}
+
+			if (std::strcmp(arg, "--games") == 0) {
+				options.games = std::max(1, std::atoi(value));
+			}
+			else if (std::strcmp(arg, "--pieces") == 0) {
+				options.maxPieces = std::max(1, std::atoi(value));
+			}
+			else if (std::strcmp(arg, "--seed") == 0) {
+				options.seed = std::strtoull(value, nullptr, 10);
+			}
+			else if (std::strcmp(arg, "--policy") == 0) {
+				options.policy = value;
+			}
+			else if (std::strcmp(arg, "--out") == 0) {
+				options.outputPath = value;
+			}
+			else {
+				std::fprintf(stderr, "unknown option %s\n", arg);
+				return false;
+			}
+
+			++i;
+		}
+
+		if (options.policy != "greedy" && options.policy != "random") {
+			std::fprintf(stderr, "unknown policy %s\n", options.policy.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	//moves the falling tetromino to the placement the same way a player would, then hard drops it
+	void PlacePiece(Game& game, const Placement& placement, BenchmarkResults& results) {
+		//gravity may have locked the tetromino while it was moving
+		if (!MoveToPlacement(game, placement)) {
+			return;
+		}
+
+		Clock::time_point lockStart = Clock::now();
+		game.ApplyInput(InputType::HardDrop, 0);
+		results.lockTimes.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - lockStart).count());
+	}
+
+	void PlayGame(const BenchmarkOptions& options, int gameIndex, BenchmarkResults& results) {
+		GameConfig config;
+		config.seed = options.seed;
+		config.stream = (uint64_t)gameIndex;
+
+		Game game;
+		game.Init(config);
+
+		//each game gets its own random numbers for the random policy
+		uint64_t randomState = options.seed + (uint64_t)gameIndex;
+
+		int pieces = 0;
+		while (!game.IsGameOver() && pieces < options.maxPieces) {
+			long long allocationsBefore = AllocationCounter::GetCount();
+			Clock::time_point spawnStart = Clock::now();
+			game.SpawnNext();
+			results.gameSeconds += std::chrono::duration<double>(Clock::now() - spawnStart).count();
+			results.gameAllocations += AllocationCounter::GetCount() - allocationsBefore;
+
+			if (game.IsGameOver()) {
+				break;
+			}
+
+			Placement placement = ChoosePlacement(options.policy == "greedy" ? PolicyType::Greedy : PolicyType::Random, game, randomState);
+
+			allocationsBefore = AllocationCounter::GetCount();
+			Clock::time_point placeStart = Clock::now();
+			PlacePiece(game, placement, results);
+			results.gameSeconds += std::chrono::duration<double>(Clock::now() - placeStart).count();
+			results.gameAllocations += AllocationCounter::GetCount() - allocationsBefore;
+
+			uint32_t events = game.TakeEvents();
+			if (events & EventLinesCleared) {
+				results.lineClears++;
+				results.linesCleared += game.GetLastLock().rowsCleared;
+			}
+
+			pieces++;
+		}
+
+		results.pieces += pieces;
+		results.score += game.GetScore();
+	}
+
+	long long Percentile(std::vector<long long>& values, double percentile) {
+		if (values.empty()) {
+			return 0;
+		}
+
+		size_t index = std::min(values.size() - 1, (size_t)(percentile * (double)values.size()));
+		std::nth_element(values.begin(), values.begin() + (std::ptrdiff_t)index, values.end());
+		return values[index];
+	}
+
+	bool WriteResults(const BenchmarkOptions& options, BenchmarkResults& results) {
+		FILE* file = std::fopen(options.outputPath.c_str(), "w");
+		if (file == nullptr) {
+			std::fprintf(stderr, "couldn't write %s\n", options.outputPath.c_str());
+			return false;
+		}
+
+		double gameSeconds = std::max(results.gameSeconds, 1e-9);
+		long long lockP50 = Percentile(results.lockTimes, 0.50);
+		long long lockP99 = Percentile(results.lockTimes, 0.99);
+
+		std::fprintf(file, "{\n");
+		std::fprintf(file, "\t\"policy\": \"%s\",\n", options.policy.c_str());
+		std::fprintf(file, "\t\"seed\": %llu,\n", (unsigned long long)options.seed);
+		std::fprintf(file, "\t\"games\": %d,\n", options.games);
+		std::fprintf(file, "\t\"pieces\": %lld,\n", results.pieces);
+		std::fprintf(file, "\t\"line_clears\": %lld,\n", results.lineClears);
+		std::fprintf(file, "\t\"lines_cleared\": %lld,\n", results.linesCleared);
+		std::fprintf(file, "\t\"total_score\": %lld,\n", results.score);
+		std::fprintf(file, "\t\"game_seconds\": %.6f,\n", results.gameSeconds);
+		std::fprintf(file, "\t\"wall_seconds\": %.6f,\n", results.wallSeconds);
+		std::fprintf(file, "\t\"pieces_per_sec\": %.1f,\n", (double)results.pieces / gameSeconds);
+		std::fprintf(file, "\t\"line_clears_per_sec\": %.1f,\n", (double)results.lineClears / gameSeconds);
+		std::fprintf(file, "\t\"games_per_sec\": %.3f,\n", (double)options.games / gameSeconds);
+		std::fprintf(file, "\t\"lock_ns_p50\": %lld,\n", lockP50);
+		std::fprintf(file, "\t\"lock_ns_p99\": %lld,\n", lockP99);
+		std::fprintf(file, "\t\"game_allocations\": %lld\n", results.gameAllocations);
+		std::fprintf(file, "}\n");
+		std::fclose(file);
+
+		std::printf("%lld pieces, %lld line clears in %.3fs of game time (%.3fs wall)\n", results.pieces, results.lineClears, results.gameSeconds, results.wallSeconds);
+		std::printf("%.1f pieces/sec, %.1f line clears/sec, lock p50 %lldns p99 %lldns\n", (double)results.pieces / gameSeconds, (double)results.lineClears / gameSeconds, lockP50, lockP99);
+		std::printf("%lld heap allocations inside the game\n", results.gameAllocations);
+		std::printf("results written to %s\n", options.outputPath.c_str());
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		return 1;
+	}
+
+	BenchmarkResults results;
+	results.lockTimes.reserve((size_t)options.games * (size_t)options.maxPieces);
+
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < options.games; ++i) {
+		PlayGame(options, i, results);
+	}
+	results.wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	if (!WriteResults(options, results)) {
+		return 1;
+	}
+
+	//lock, clear, spawn and rotate should never touch the heap
+	if (options.failOnAllocation && results.gameAllocations > 0) {
+		std::fprintf(stderr, "FAILED: the game made %lld heap allocations\n", results.gameAllocations);
+		return 2;
+	}
+
+	return 0;
+}
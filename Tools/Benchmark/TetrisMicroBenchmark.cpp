@@ -0,0 +1,329 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+//microbenchmarks of the hot paths of TetrisCore, each run on the same board fixtures
+//reports ns/op and heap allocations/op for every benchmark and fixture
+//
+//usage: TetrisMicroBenchmark [--iterations N] [--out file.json] [--fail-on-allocation]
+//with --fail-on-allocation the suite exits with an error if any benchmark made a heap allocation
+
+#include "AllocationCounter.h"
+#include "TetrisCore/TetrisBits.h"
+#include "TetrisCore/TetrisEvaluator.h"
+#include "TetrisCore/TetrisGame.h"
+#include "TetrisCore/TetrisLatency.h"
+#include "TetrisCore/TetrisMoveGenerator.h"
+#include "TetrisCore/TetrisSimulation.h"
+#include "TetrisCore/TetrisTranspositionTable.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace TetrisCore;
+
+typedef std::chrono::steady_clock Clock;
+
+namespace
+{
+	//stops the compiler removing work whose result isn't used
+	volatile uint64_t sink;
+
+	struct Fixture
+	{
+		const char* name;
+		Board board;
+	};
+
+	struct BenchmarkResult
+	{
+		std::string benchmark;
+		std::string fixture;
+		double nsPerOp;
+		double allocationsPerOp;
+	};
+
+	//fills the rows from firstRow up to (but not including) lastRow, leaving a gap in a different column on each row
+	void FillRowsWithGaps(Board& board, int firstRow, int lastRow) {
+		for (int row = firstRow; row < lastRow; ++row) {
+			int gap = (row * 3) % board.GetNumColumns();
+			for (int column = 0; column < board.GetNumColumns(); ++column) {
+				if (column != gap) {
+					board.SetCell(column, row);
+				}
+			}
+		}
+	}
+
+	std::vector<Fixture> MakeFixtures() {
+		std::vector<Fixture> fixtures(4);
+
+		fixtures[0].name = "empty";
+
+		fixtures[1].name = "half_full";
+		FillRowsWithGaps(fixtures[1].board, 0, 10);
+
+		//stack reaches just under the spawn point
+		fixtures[2].name = "near_overflow";
+		FillRowsWithGaps(fixtures[2].board, 0, 18);
+
+		fixtures[3].name = "checkerboard_holes";
+		for (int row = 0; row < 12; ++row) {
+			for (int column = 0; column < fixtures[3].board.GetNumColumns(); ++column) {
+				if ((row + column) % 2 == 0) {
+					fixtures[3].board.SetCell(column, row);
+				}
+			}
+		}
+
+		return fixtures;
+	}
+
+	//copies the fixture onto 4 full rows with a well in the right column, so a vertical I block clears 4 rows (i.e., a tetris)
+	Board MakeTetrisWell(const Board& fixture) {
+		Board board;
+		board.Init(fixture.GetNumColumns());
+
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < board.GetNumColumns() - 1; ++column) {
+				board.SetCell(column, row);
+			}
+		}
+
+		for (int row = 0; row + 4 < Board::MaxRows; ++row) {
+			for (int column = 0; column < fixture.GetNumColumns(); ++column) {
+				if (fixture.IsOccupied(column, row)) {
+					board.SetCell(column, row + 4);
+				}
+			}
+		}
+
+		return board;
+	}
+
+	//gets a T block resting on top of the stack in the middle of the playfield, where rotating it has to wall kick
+	Piece MakeRestingT(const Board& board) {
+		int surface = 0;
+		for (int column = 3; column <= 5; ++column) {
+			surface = std::max(surface, board.GetColumnHeight(column));
+		}
+
+		return Piece{ PieceType::T, 0, 4, surface };
+	}
+
+	//runs the operation the given amount of times and records ns/op and allocations/op
+	template <typename Operation>
+	void Run(std::vector<BenchmarkResult>& results, const char* benchmark, const Fixture& fixture, int iterations, Operation operation) {
+		//warm up caches and branch predictors before timing
+		for (int i = 0; i < iterations / 10; ++i) {
+			operation();
+		}
+
+		long long allocationsBefore = AllocationCounter::GetCount();
+		Clock::time_point start = Clock::now();
+
+		for (int i = 0; i < iterations; ++i) {
+			operation();
+		}
+
+		double nanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+		long long allocations = AllocationCounter::GetCount() - allocationsBefore;
+
+		BenchmarkResult result;
+		result.benchmark = benchmark;
+		result.fixture = fixture.name;
+		result.nsPerOp = nanoseconds / (double)iterations;
+		result.allocationsPerOp = (double)allocations / (double)iterations;
+		results.push_back(result);
+
+		std::printf("%-28s %-20s %10.2f ns/op %8.3f allocs/op\n", benchmark, fixture.name, result.nsPerOp, result.allocationsPerOp);
+	}
+
+	void RunBenchmarks(const Fixture& fixture, int iterations, std::vector<BenchmarkResult>& results) {
+		const Board& board = fixture.board;
+
+		//collision test of a tetromino at the spawn point, as done for every sideways move and rotation
+		Cell spawnCells[4];
+		Piece{ PieceType::T, 0, 5, 20 }.GetCells(spawnCells);
+		Run(results, "collides", fixture, iterations, [&]() {
+			sink = sink + (uint64_t)board.Collides(spawnCells);
+		});
+
+		//drop distance from the spawn point, as used by the ghost and hard drop
+		Cell iCells[4];
+		Piece{ PieceType::I, 0, 4, 20 }.GetCells(iCells);
+		Run(results, "drop_distance", fixture, iterations, [&]() {
+			sink = sink + (uint64_t)board.GetDropDistance(iCells);
+		});
+
+		//testing all 5 rotation candidates of a T block resting on the stack
+		Piece restingT = MakeRestingT(board);
+		Cell rotatedCells[4];
+		restingT.Rotated(1).GetCells(rotatedCells);
+		const Cell* kicks = WallKicks[GetKickClass(PieceType::T)][GetKickTransition(0, 1)];
+		const Cell candidates[5] = { { 0, 0 }, kicks[0], kicks[1], kicks[2], kicks[3] };
+		Run(results, "wall_kick_candidates", fixture, iterations, [&]() {
+			sink = sink + board.FindFittingOffsets(rotatedCells, candidates, 5);
+		});
+
+		//a full rotation of the resting T block, including the T spin check. Setting the piece back each time is measured on its own
+		Game game;
+		game.LoadPosition(board, restingT);
+		Run(results, "set_piece_baseline", fixture, iterations, [&]() {
+			game.SetPiece(restingT);
+			sink = sink + game.TakeEvents();
+		});
+		Run(results, "rotate_t_spin_check", fixture, iterations, [&]() {
+			game.SetPiece(restingT);
+			sink = sink + (uint64_t)game.Rotate(1) + game.TakeEvents();
+		});
+
+		//snapshot and restore of the whole game, as used for undo and rollback
+		GameState snapshot;
+		Run(results, "save_restore_state", fixture, iterations, [&]() {
+			game.SaveState(snapshot);
+			game.RestoreState(snapshot);
+			sink = sink + game.TakeEvents();
+		});
+
+		//an input through the simulation thread's command queue, pushed and popped on the same thread so only the queue itself is measured
+		static SpscQueue<SimulationCommand, SimulationThread::CommandQueueSize> commandQueue;
+		SimulationCommand command = { InputType::Rotate, 1, Clock::now() };
+		Run(results, "spsc_push_pop", fixture, iterations, [&]() {
+			commandQueue.TryPush(command);
+			commandQueue.TryPop(command);
+			sink = sink + (uint64_t)command.value;
+		});
+
+		//following 1 input through the latency tracker, from being received to being shown, as done for every player input
+		static LatencyTracker latencyTracker;
+		Clock::time_point inputTime = Clock::now();
+		Run(results, "latency_track_input", fixture, iterations, [&]() {
+			uint64_t input = latencyTracker.Received(LatencyAction::Move, inputTime);
+			latencyTracker.Applied(input, inputTime);
+			latencyTracker.Presented(input, inputTime);
+			sink = sink + input;
+		});
+
+		//locking a vertical I block into a well and clearing the 4 rows. Copying the board back each time is measured on its own
+		Board wellBoard = MakeTetrisWell(board);
+		Board scratch = wellBoard;
+		Cell wellCells[4];
+		Piece{ PieceType::I, 1, board.GetNumColumns() - 2, 2 }.GetCells(wellCells);
+		Run(results, "board_copy_baseline", fixture, iterations, [&]() {
+			scratch = wellBoard;
+			sink = sink + scratch.GetRow(0);
+		});
+		Run(results, "lock_and_clear", fixture, iterations, [&]() {
+			scratch = wellBoard;
+			scratch.LockCells(wellCells, (uint8_t)PieceType::I);
+			uint64_t fullRows = scratch.FindFullRows(wellCells);
+			scratch.RemoveRows(fullRows);
+			sink = sink + fullRows;
+		});
+
+		//every lock position of a T block from the spawn point. A full search is far slower than the other benchmarks, so it runs fewer times
+		//the generator holds its search memory, so it is kept between fixtures rather than on the stack
+		static MoveGenerator moveGenerator;
+		const Piece spawnT = Piece{ PieceType::T, 0, 5, 20 };
+		Run(results, "move_generation", fixture, std::max(1, iterations / 100), [&]() {
+			sink = sink + (uint64_t)moveGenerator.Generate(board, spawnT);
+		});
+
+		//features of a full batch of 16 copies of the board (1 op = 16 boards), with SIMD and without
+		static BoardBatch batch;
+		static BoardFeatures features[BoardBatch::Size];
+		batch.Clear(board.GetNumColumns());
+		for (int i = 0; i < BoardBatch::Size; ++i) {
+			batch.Add(board, 0);
+		}
+
+		Run(results, "evaluate_batch_16", fixture, std::max(1, iterations / 10), [&]() {
+			EvaluateBatches(&batch, 1, features);
+			sink = sink + (uint64_t)features[0].holes;
+		});
+		Run(results, "evaluate_batch_16_scalar", fixture, std::max(1, iterations / 10), [&]() {
+			EvaluateBatchesScalar(&batch, 1, features);
+			sink = sink + (uint64_t)features[0].holes;
+		});
+
+		//transposition table lookup of the board's hash, stored once so every probe hits
+		static TranspositionTable table(14);
+		table.Store(board.GetHash(), 1.f);
+
+		Run(results, "transposition_probe", fixture, iterations, [&]() {
+			float score = 0.f;
+			sink = sink + (uint64_t)table.Probe(board.GetHash(), score);
+		});
+	}
+
+	bool WriteResults(const std::string& outputPath, int iterations, const std::vector<BenchmarkResult>& results) {
+		FILE* file = std::fopen(outputPath.c_str(), "w");
+		if (file == nullptr) {
+			std::fprintf(stderr, "couldn't write %s\n", outputPath.c_str());
+			return false;
+		}
+
+		std::fprintf(file, "{\n\t\"iterations\": %d,\n\t\"evaluator\": \"%s\",\n\t\"results\": [\n", iterations, GetEvaluatorInstructionSet());
+		for (size_t i = 0; i < results.size(); ++i) {
+			const BenchmarkResult& result = results[i];
+			std::fprintf(file, "\t\t{ \"benchmark\": \"%s\", \"fixture\": \"%s\", \"ns_per_op\": %.3f, \"allocs_per_op\": %.3f }%s\n",
+				result.benchmark.c_str(), result.fixture.c_str(), result.nsPerOp, result.allocationsPerOp, i + 1 < results.size() ? "," : "");
+		}
+		std::fprintf(file, "\t]\n}\n");
+		std::fclose(file);
+
+		std::printf("results written to %s\n", outputPath.c_str());
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = 1000000;
+	std::string outputPath = "microbenchmark_results.json";
+
+	bool failOnAllocation = false;
+
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--fail-on-allocation") == 0) {
+			failOnAllocation = true;
+		}
+		else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+			iterations = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			outputPath = argv[++i];
+		}
+		else {
+			std::fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	std::vector<Fixture> fixtures = MakeFixtures();
+	std::vector<BenchmarkResult> results;
+	results.reserve(fixtures.size() * 11);
+
+	for (const Fixture& fixture : fixtures) {
+		RunBenchmarks(fixture, iterations, results);
+	}
+
+	if (!WriteResults(outputPath, iterations, results)) {
+		return 1;
+	}
+
+	if (failOnAllocation) {
+		for (const BenchmarkResult& result : results) {
+			if (result.allocationsPerOp > 0.0) {
+				std::fprintf(stderr, "FAILED: %s on %s made %.3f heap allocations/op\n", result.benchmark.c_str(), result.fixture.c_str(), result.allocationsPerOp);
+				return 2;
+			}
+		}
+	}
+
+	return 0;
+}
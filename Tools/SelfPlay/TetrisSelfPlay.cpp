@@ -0,0 +1,261 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+//self play farm. Plays many independent games at once on a work stealing thread pool, each with its own seed and policy,
+//then merges the stats of every game into one report. Used for balance testing the scoring and the level curve
+//
+//usage: TetrisSelfPlay [--games N] [--threads N] [--seed N] [--policy greedy|random|lookahead|mixed] [--pieces N] [--level N] [--out file.json]
+
+#include "TetrisCore/TetrisPolicy.h"
+#include "TetrisCore/TetrisThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace TetrisCore;
+
+namespace
+{
+	struct SelfPlayOptions
+	{
+		int games = 1000;
+
+		//0 = one per hardware thread
+		int threads = 0;
+
+		uint64_t seed = 1;
+
+		//mixed = alternate between the greedy and random policies
+		std::string policy = "greedy";
+
+		//games are stopped after this many pieces, so a good policy doesn't run forever
+		int maxPieces = 2000;
+
+		//level every game starts at, e.g., to soak test at max gravity
+		int startLevel = 1;
+
+		std::string outputPath = "selfplay_results.json";
+	};
+
+	struct GameResult
+	{
+		PolicyType policy;
+		GameStats stats;
+		int score;
+		int level;
+		double seconds;
+		bool toppedOut;
+	};
+
+	//stat of a game that is summarised across all games
+	struct Metric
+	{
+		const char* name;
+		double (*get)(const GameResult& result);
+	};
+
+	const Metric Metrics[] = {
+		{ "score", [](const GameResult& result) { return (double)result.score; } },
+		{ "lines", [](const GameResult& result) { return (double)result.stats.lines; } },
+		{ "level", [](const GameResult& result) { return (double)result.level; } },
+		{ "tetrises", [](const GameResult& result) { return (double)result.stats.tetrises; } },
+		{ "t_spins", [](const GameResult& result) { return (double)result.stats.tSpins; } },
+		{ "mini_t_spins", [](const GameResult& result) { return (double)result.stats.miniTSpins; } },
+		{ "pieces", [](const GameResult& result) { return (double)result.stats.pieces; } },
+		{ "game_seconds", [](const GameResult& result) { return result.seconds; } },
+	};
+
+	bool ParseOptions(int argc, char** argv, SelfPlayOptions& options) {
+		for (int i = 1; i + 1 < argc; i += 2) {
+			const char* arg = argv[i];
+			const char* value = argv[i + 1];
+
+			if (std::strcmp(arg, "--games") == 0) {
+				options.games = std::max(1, std::atoi(value));
+			}
+			else if (std::strcmp(arg, "--threads") == 0) {
+				options.threads = std::max(0, std::atoi(value));
+			}
+			else if (std::strcmp(arg, "--seed") == 0) {
+				options.seed = std::strtoull(value, nullptr, 10);
+			}
+			else if (std::strcmp(arg, "--policy") == 0) {
+				options.policy = value;
+			}
+			else if (std::strcmp(arg, "--pieces") == 0) {
+				options.maxPieces = std::max(1, std::atoi(value));
+			}
+			else if (std::strcmp(arg, "--level") == 0) {
+				options.startLevel = std::max(1, std::atoi(value));
+			}
+			else if (std::strcmp(arg, "--out") == 0) {
+				options.outputPath = value;
+			}
+			else {
+				std::fprintf(stderr, "unknown option %s\n", arg);
+				return false;
+			}
+		}
+
+		if (argc % 2 == 0) {
+			std::fprintf(stderr, "missing value for %s\n", argv[argc - 1]);
+			return false;
+		}
+
+		if (options.policy != "greedy" && options.policy != "random" && options.policy != "lookahead" && options.policy != "mixed") {
+			std::fprintf(stderr, "unknown policy %s\n", options.policy.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	PolicyType GetGamePolicy(const SelfPlayOptions& options, int gameIndex) {
+		if (options.policy == "mixed") {
+			return gameIndex % 2 == 0 ? PolicyType::Greedy : PolicyType::Random;
+		}
+
+		if (options.policy == "lookahead") {
+			return PolicyType::Lookahead;
+		}
+
+		return options.policy == "random" ? PolicyType::Random : PolicyType::Greedy;
+	}
+
+	//plays 1 game. Runs on a worker thread, so it only touches its own result
+	void PlaySelfPlayGame(const SelfPlayOptions& options, int gameIndex, GameResult& result) {
+		//every game has its own randomizer stream, so no two games get the same tetrominoes
+		GameConfig config;
+		config.seed = options.seed;
+		config.stream = (uint64_t)gameIndex;
+		config.startLevel = options.startLevel;
+
+		Game game;
+		game.Init(config);
+
+		result.policy = GetGamePolicy(options, gameIndex);
+		PlayGame(game, result.policy, options.maxPieces, options.seed ^ ((uint64_t)gameIndex << 32));
+
+		result.stats = game.GetStats();
+		result.score = game.GetScore();
+		result.level = game.GetLevel();
+		result.seconds = (double)game.GetStepCount() / (double)config.stepsPerSecond;
+		result.toppedOut = game.IsGameOver();
+	}
+
+	const char* GetPolicyName(PolicyType policy) {
+		switch (policy) {
+		case PolicyType::Random:
+			return "random";
+		case PolicyType::Lookahead:
+			return "lookahead";
+		default:
+			return "greedy";
+		}
+	}
+
+	//writes the mean, min, percentiles and max of every metric across the given games
+	void WriteAggregate(FILE* file, const std::vector<const GameResult*>& games) {
+		std::vector<double> values(games.size());
+
+		int toppedOut = 0;
+		for (const GameResult* result : games) {
+			toppedOut += result->toppedOut ? 1 : 0;
+		}
+
+		std::fprintf(file, "\t\t\t\"games\": %d,\n", (int)games.size());
+		std::fprintf(file, "\t\t\t\"topped_out\": %d,\n", toppedOut);
+
+		const int numMetrics = (int)(sizeof(Metrics) / sizeof(Metrics[0]));
+		for (int metric = 0; metric < numMetrics; ++metric) {
+			double total = 0.0;
+			for (size_t i = 0; i < games.size(); ++i) {
+				values[i] = Metrics[metric].get(*games[i]);
+				total += values[i];
+			}
+
+			std::sort(values.begin(), values.end());
+			double mean = total / (double)games.size();
+			double p50 = values[values.size() / 2];
+			double p90 = values[std::min(values.size() - 1, values.size() * 9 / 10)];
+
+			std::fprintf(file, "\t\t\t\"%s\": { \"mean\": %.2f, \"min\": %.0f, \"p50\": %.0f, \"p90\": %.0f, \"max\": %.0f }%s\n",
+				Metrics[metric].name, mean, values.front(), p50, p90, values.back(), metric + 1 < numMetrics ? "," : "");
+		}
+	}
+
+	bool WriteReport(const SelfPlayOptions& options, int threads, double wallSeconds, const std::vector<GameResult>& results) {
+		FILE* file = std::fopen(options.outputPath.c_str(), "w");
+		if (file == nullptr) {
+			std::fprintf(stderr, "couldn't write %s\n", options.outputPath.c_str());
+			return false;
+		}
+
+		std::fprintf(file, "{\n");
+		std::fprintf(file, "\t\"seed\": %llu,\n", (unsigned long long)options.seed);
+		std::fprintf(file, "\t\"threads\": %d,\n", threads);
+		std::fprintf(file, "\t\"max_pieces\": %d,\n", options.maxPieces);
+		std::fprintf(file, "\t\"wall_seconds\": %.3f,\n", wallSeconds);
+		std::fprintf(file, "\t\"games_per_sec\": %.1f,\n", (double)results.size() / std::max(wallSeconds, 1e-9));
+		std::fprintf(file, "\t\"policies\": {\n");
+
+		//one aggregate per policy that was played
+		bool first = true;
+		for (int policy = 0; policy < (int)PolicyType::Count; ++policy) {
+			std::vector<const GameResult*> games;
+			for (const GameResult& result : results) {
+				if ((int)result.policy == policy) {
+					games.push_back(&result);
+				}
+			}
+
+			if (games.empty()) {
+				continue;
+			}
+
+			std::fprintf(file, "%s\t\t\"%s\": {\n", first ? "" : ",\n", GetPolicyName((PolicyType)policy));
+			WriteAggregate(file, games);
+			std::fprintf(file, "\t\t}");
+			first = false;
+		}
+
+		std::fprintf(file, "\n\t}\n}\n");
+		std::fclose(file);
+
+		std::printf("%d games on %d threads in %.3fs (%.1f games/sec)\n", (int)results.size(), threads, wallSeconds, (double)results.size() / std::max(wallSeconds, 1e-9));
+		std::printf("results written to %s\n", options.outputPath.c_str());
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	SelfPlayOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		return 1;
+	}
+
+	//every game writes straight into its own slot, so the games never share anything until the report is made
+	std::vector<GameResult> results((size_t)options.games);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int threads;
+	{
+		ThreadPool pool(options.threads);
+		threads = pool.GetNumThreads();
+
+		for (int i = 0; i < options.games; ++i) {
+			GameResult* result = &results[(size_t)i];
+			pool.Submit([&options, i, result]() { PlaySelfPlayGame(options, i, *result); });
+		}
+
+		pool.Wait();
+	}
+	double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	return WriteReport(options, threads, wallSeconds, results) ? 0 : 1;
+}